@@ -5,10 +5,13 @@
 //	The file header is used to locate where on disk the
 //	file's data is stored.  We implement this as a fixed size
 //	table of pointers -- each entry in the table points to the
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector,
+//	disk sector containing that portion of the file data --
+//	followed by a pointer to an indirect block, and one to a
+//	doubly indirect block, for the data beyond that.  The table
+//	size is chosen so that the file header will be just big
+//	enough to fit in one disk sector.  Data sectors are allocated
+//	in runs on one track where possible, so that consecutive
+//	pointers often describe an extent of consecutive sectors.
 //
 //      Unlike in a real system, we do not keep track of file permissions,
 //	ownership, last modification date, etc., in the file header.
@@ -26,45 +29,156 @@
 
 #include "filehdr.h"
 #include "debug.h"
-#include "synchdisk.h"
+#include "synchcache.h"
 #include "main.h"
 
+//----------------------------------------------------------------------
+// NumIndexSectors
+// 	Return how many indirect and doubly indirect blocks a file of
+//	"numSectors" data sectors needs.
+//----------------------------------------------------------------------
+
+static int NumIndexSectors(int numSectors) {
+    int beyond = numSectors - NumDirect;  // sectors not in the header
+
+    if (beyond <= 0) {
+        return 0;
+    } else if (beyond <= (int)NumIndirect) {
+        return 1;
+    }
+    beyond -= NumIndirect;
+    return 2 + divRoundUp(beyond, NumIndirect);
+}
+
+//----------------------------------------------------------------------
+// AllocateIndex
+// 	Allocate an index block out of "freeMap", pointing to the
+//	"numData" data sectors in "data", and write it to disk.  Returns
+//	the index block's sector.
+//----------------------------------------------------------------------
+
+static int AllocateIndex(PersistentBitmap *freeMap, int *data, int numData) {
+    int map[NumIndirect];
+    int sector = freeMap->FindAndSet();
+
+    ASSERT(sector >= 0 && numData <= (int)NumIndirect);
+    for (int i = 0; i < (int)NumIndirect; i++) {
+        map[i] = (i < numData) ? data[i] : -1;
+    }
+    kernel->synchCache->WriteSector(sector, (char *)map);
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::FileHeader
+// 	Initialize an empty file header, with no index blocks cached.
+//	It gets its contents from Allocate or FetchFrom.
+//----------------------------------------------------------------------
+
+FileHeader::FileHeader() {
+    numBytes = numSectors = 0;
+    indirectSector = doubleIndirectSector = -1;
+    cachedSector = -1;
+    doubleLoaded = FALSE;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Allocate
 // 	Initialize a fresh file header for a newly created file.
-//	Allocate data blocks for the file out of the map of free disk blocks.
+//	Allocate data blocks for the file out of the map of free disk
+//	blocks, along with whatever index blocks it needs to find them.
 //	Return FALSE if there are not enough free blocks to accomodate
 //	the new file.
 //
 //	"freeMap" is the bit map of free disk sectors
-//	"fileSize" is the bit map of free disk sectors
+//	"fileSize" is the size of the file, in bytes
 //----------------------------------------------------------------------
 
 bool FileHeader::Allocate(PersistentBitmap *freeMap, int fileSize) {
+    int i, j, start, run, next, left;
+    int *sectors;
+
     numBytes = fileSize;
     numSectors = divRoundUp(fileSize, SectorSize);
-    if (freeMap->NumClear() < numSectors) return FALSE;  // not enough space
+    if (numSectors > (int)MaxFileSectors ||
+        freeMap->NumClear() < numSectors + NumIndexSectors(numSectors))
+        return FALSE;  // not enough space
 
-    for (int i = 0; i < numSectors; i++) {
-        dataSectors[i] = freeMap->FindAndSet();
-        // since we checked that there was enough free space,
-        // we expect this to succeed
-        ASSERT(dataSectors[i] >= 0);
+    // The data goes first, in as few runs as we can find, so that
+    // the index blocks don't break them up.  Since we checked that
+    // there was enough free space, we expect all of these to succeed.
+    sectors = new int[numSectors];
+    for (i = 0; i < numSectors; i += run) {
+        start = freeMap->FindAndSetRun(numSectors - i, &run);
+        ASSERT(start >= 0);
+        for (j = 0; j < run; j++) {
+            sectors[i + j] = start + j;
+        }
+    }
+
+    for (i = 0; i < (int)NumDirect; i++) {
+        dataSectors[i] = (i < numSectors) ? sectors[i] : -1;
+    }
+    next = NumDirect;
+    left = numSectors - NumDirect;
+
+    indirectSector = doubleIndirectSector = -1;
+    if (left > 0) {
+        run = min(left, (int)NumIndirect);
+        indirectSector = AllocateIndex(freeMap, &sectors[next], run);
+        next += run;
+        left -= run;
+    }
+    if (left > 0) {
+        doubleIndirectSector = freeMap->FindAndSet();
+        ASSERT(doubleIndirectSector >= 0);
+        for (i = 0; i < (int)NumIndirect; i++) {
+            if (left > 0) {
+                run = min(left, (int)NumIndirect);
+                doubleMap[i] = AllocateIndex(freeMap, &sectors[next], run);
+                next += run;
+                left -= run;
+            } else {
+                doubleMap[i] = -1;
+            }
+        }
+        kernel->synchCache->WriteSector(doubleIndirectSector,
+                                        (char *)doubleMap);
     }
+    delete[] sectors;
+    cachedSector = -1;
+    doubleLoaded = (doubleIndirectSector >= 0);
     return TRUE;
 }
 
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
-// 	De-allocate all the space allocated for data blocks for this file.
+// 	De-allocate all the space allocated for data blocks for this file,
+//	and the index blocks that point to them.
 //
 //	"freeMap" is the bit map of free disk sectors
 //----------------------------------------------------------------------
 
 void FileHeader::Deallocate(PersistentBitmap *freeMap) {
-    for (int i = 0; i < numSectors; i++) {
-        ASSERT(freeMap->Test((int)dataSectors[i]));  // ought to be marked!
-        freeMap->Clear((int)dataSectors[i]);
+    int i, sector;
+
+    for (i = 0; i < numSectors; i++) {
+        sector = ByteToSector(i * SectorSize);
+        ASSERT(freeMap->Test(sector));  // ought to be marked!
+        freeMap->Clear(sector);
+    }
+    if (indirectSector >= 0) {
+        ASSERT(freeMap->Test(indirectSector));
+        freeMap->Clear(indirectSector);
+    }
+    if (doubleIndirectSector >= 0) {
+        IndexBlock(doubleIndirectSector);  // make sure doubleMap is in
+        for (i = 0; i < (int)NumIndirect && doubleMap[i] >= 0; i++) {
+            ASSERT(freeMap->Test(doubleMap[i]));
+            freeMap->Clear(doubleMap[i]);
+        }
+        ASSERT(freeMap->Test(doubleIndirectSector));
+        freeMap->Clear(doubleIndirectSector);
     }
 }
 
@@ -76,7 +190,10 @@ void FileHeader::Deallocate(PersistentBitmap *freeMap) {
 //----------------------------------------------------------------------
 
 void FileHeader::FetchFrom(int sector) {
-    kernel->synchDisk->ReadSector(sector, (char *)this);
+    // the fields kept on disk come first, and fill the sector
+    kernel->synchCache->ReadSector(sector, (char *)this);
+    cachedSector = -1;
+    doubleLoaded = FALSE;
 }
 
 //----------------------------------------------------------------------
@@ -87,7 +204,7 @@ void FileHeader::FetchFrom(int sector) {
 //----------------------------------------------------------------------
 
 void FileHeader::WriteBack(int sector) {
-    kernel->synchDisk->WriteSector(sector, (char *)this);
+    kernel->synchCache->WriteSector(sector, (char *)this);
 }
 
 //----------------------------------------------------------------------
@@ -97,11 +214,74 @@ void FileHeader::WriteBack(int sector) {
 //	offset in the file) to a physical address (the sector where the
 //	data at the offset is stored).
 //
+//	The index blocks used are kept, so going through a file in
+//	order reads each of them just once.
+//
 //	"offset" is the location within the file of the byte in question
 //----------------------------------------------------------------------
 
 int FileHeader::ByteToSector(int offset) {
-    return (dataSectors[offset / SectorSize]);
+    int i = offset / SectorSize;
+
+    if (i < (int)NumDirect) {
+        return (dataSectors[i]);
+    }
+    i -= NumDirect;
+    if (i < (int)NumIndirect) {
+        return IndexBlock(indirectSector)[i];
+    }
+    i -= NumIndirect;
+    ASSERT(i < (int)(NumIndirect * NumIndirect));
+    IndexBlock(doubleIndirectSector);
+    return IndexBlock(doubleMap[i / NumIndirect])[i % NumIndirect];
+}
+
+//----------------------------------------------------------------------
+// FileHeader::ByteToExtent
+// 	Return which disk sector is storing a particular byte within the
+//	file, as ByteToSector does, and in "numSectors", how many of the
+//	file's sectors from there on -- "maxSectors" at most -- are
+//	consecutive on disk, without crossing into the next track.  They
+//	can all be read with a single disk request.
+//
+//	"offset" is the location within the file of the byte in question
+//	"maxSectors" is the most sectors the caller wants
+//----------------------------------------------------------------------
+
+int FileHeader::ByteToExtent(int offset, int maxSectors, int *numSectors) {
+    int first = ByteToSector(offset);
+    int n = 1;
+
+    while (n < maxSectors && ((first + n) % SectorsPerTrack) != 0 &&
+           ByteToSector(offset + n * SectorSize) == first + n) {
+        n++;
+    }
+    *numSectors = n;
+    return first;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::IndexBlock
+// 	Return the contents of the index block in "sector", reading it
+//	in only if it isn't the one we read last.  The doubly indirect
+//	block is kept separately, since it is needed along with each
+//	indirect block it points to.
+//----------------------------------------------------------------------
+
+int *FileHeader::IndexBlock(int sector) {
+    ASSERT(sector >= 0);
+    if (sector == doubleIndirectSector) {
+        if (!doubleLoaded) {
+            kernel->synchCache->ReadSector(sector, (char *)doubleMap);
+            doubleLoaded = TRUE;
+        }
+        return doubleMap;
+    }
+    if (sector != cachedSector) {
+        kernel->synchCache->ReadSector(sector, (char *)cachedMap);
+        cachedSector = sector;
+    }
+    return cachedMap;
 }
 
 //----------------------------------------------------------------------
@@ -122,10 +302,11 @@ void FileHeader::Print() {
     char *data = new char[SectorSize];
 
     printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
-    for (i = 0; i < numSectors; i++) printf("%d ", dataSectors[i]);
+    for (i = 0; i < numSectors; i++)
+        printf("%d ", ByteToSector(i * SectorSize));
     printf("\nFile contents:\n");
     for (i = k = 0; i < numSectors; i++) {
-        kernel->synchDisk->ReadSector(dataSectors[i], data);
+        kernel->synchCache->ReadSector(ByteToSector(i * SectorSize), data);
         for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
             if ('\040' <= data[j] && data[j] <= '\176')  // isprint(data[j])
                 printf("%c", data[j]);
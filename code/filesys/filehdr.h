@@ -17,26 +17,41 @@
 #include "disk.h"
 #include "pbitmap.h"
 
-#define NumDirect ((SectorSize - 2 * sizeof(int)) / sizeof(int))
-#define MaxFileSize (NumDirect * SectorSize)
+#define NumDirect ((SectorSize - 4 * sizeof(int)) / sizeof(int))
+#define NumIndirect (SectorSize / sizeof(int))  // pointers in an index block
+#define MaxFileSectors (NumDirect + NumIndirect + NumIndirect * NumIndirect)
+#define MaxFileSize (MaxFileSectors * SectorSize)
 
 // The following class defines the Nachos "file header" (in UNIX terms,
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks.
+// As in UNIX, the file header has pointers to the first few data
+// blocks; then a pointer to an "indirect" block, a sector full of
+// pointers to the data blocks that come next; then a pointer to a
+// "doubly indirect" block, a sector full of pointers to indirect
+// blocks, for the rest of the file.
 //
 // The file header data structure can be stored in memory or on disk.
 // When it is on disk, it is stored in a single sector -- this means
-// that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// that the fields kept on disk must add up to one disk sector.  With
+// 128 byte sectors, that allows files of up to 1084 sectors -- more
+// than the whole disk.
 //
-// There is no constructor; rather the file header can be initialized
-// by allocating blocks for the file (if it is a new file), or by
-// reading it from disk.
+// Data blocks are allocated in contiguous runs on a track where they
+// can be, so that the file's sectors can be read back a run at a time:
+// each run of consecutive pointers is an "extent".
+//
+// In memory, the header also keeps the index blocks ByteToSector
+// used last, so that reading through a file costs an extra disk
+// read per indirect block, rather than one per sector.
+//
+// The file header can be initialized by allocating blocks for the
+// file (if it is a new file), or by reading it from disk.
 
 class FileHeader {
    public:
+    FileHeader();  // An empty header, to be filled in by
+                   // Allocate or FetchFrom
+
     bool Allocate(PersistentBitmap *bitMap,
                   int fileSize);                // Initialize a file header,
                                                 //  including allocating space
@@ -52,16 +67,36 @@ class FileHeader {
                                    // to the disk sector containing
                                    // the byte
 
+    int ByteToExtent(int offset, int maxSectors, int *numSectors);
+    // Like ByteToSector, but also return
+    // how many of the next "maxSectors"
+    // sectors of the file follow on from
+    // it on the same track
+
     int FileLength();  // Return the length of the file
                        // in bytes
 
     void Print();  // Print the contents of the file.
 
    private:
+    // Kept on disk, in this order; exactly one sector.
     int numBytes;                // Number of bytes in the file
     int numSectors;              // Number of data sectors in the file
-    int dataSectors[NumDirect];  // Disk sector numbers for each data
-                                 // block in the file
+    int dataSectors[NumDirect];  // Disk sector numbers for the first
+                                 // NumDirect data blocks in the file
+    int indirectSector;          // Index block for the next NumIndirect
+                                 // data blocks, -1 if none
+    int doubleIndirectSector;    // Index block of index blocks for the
+                                 // rest, -1 if none
+
+    // Kept only in memory.
+    int cachedSector;            // Index block in "cachedMap", -1 if none
+    int cachedMap[NumIndirect];  // Its contents
+    bool doubleLoaded;           // Is the doubly indirect block in
+    int doubleMap[NumIndirect];  // "doubleMap"?
+
+    int *IndexBlock(int sector);  // Return the contents of an index
+                                  // block, reading it in if need be
 };
 
 #endif  // FILEHDR_H
@@ -70,7 +70,7 @@
 // 	Initialize the file system.  If format = TRUE, the disk has
 //	nothing on it, and we need to initialize the disk to contain
 //	an empty directory, and a bitmap of free sectors (with almost but
-//	not all of the sectors marked as free).
+//	not all of the sectors marked as free: the swap area is kept back).
 //
 //	If format = FALSE, we just have to open the files
 //	representing the bitmap and the directory.
@@ -92,6 +92,9 @@ FileSystem::FileSystem(bool format) {
         // (make sure no one else grabs these!)
         freeMap->Mark(FreeMapSector);
         freeMap->Mark(DirectorySector);
+        for (int i = FirstSwapSector; i < NumSectors; i++) {
+            freeMap->Mark(i);  // the swap area
+        }
 
         // Second, allocate space for the data blocks containing the contents
         // of the directory and bitmap files.  There better be enough space!
@@ -343,6 +346,8 @@ OpenFile *FileSystem::Open(char *name) {
     return new OpenFile(fileDescriptor);
 }
 
-int FileSystem::FileTableIndex() { return kernel->currentThread->processID; };
+int FileSystem::FileTableIndex() {
+    return kernel->pTab->Slot(kernel->currentThread->processID);
+};
 
 #endif  // FILESYS_STUB
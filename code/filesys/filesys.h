@@ -45,9 +45,11 @@
 // implementation is available
 class FileSystem {
    public:
-    FileTable **fileTable;
+    FileTable **fileTable;  // one per process table slot
+    int numFileTables;
 
     FileSystem() {
+        numFileTables = MAX_PROCESS;
         fileTable = new FileTable *[MAX_PROCESS];
         for (int i = 0; i < MAX_PROCESS; i++) {
             fileTable[i] = new FileTable;
@@ -55,12 +57,23 @@ class FileSystem {
     }
 
     ~FileSystem() {
-        for (int i = 0; i < MAX_PROCESS; i++) {
+        for (int i = 0; i < numFileTables; i++) {
             delete fileTable[i];
         }
         delete[] fileTable;
     }
 
+    void Resize(int size) {  // the process table now has "size" slots
+        if (size <= numFileTables) return;
+        FileTable **newTable = new FileTable *[size];
+        for (int i = 0; i < size; i++) {
+            newTable[i] = (i < numFileTables) ? fileTable[i] : new FileTable;
+        }
+        delete[] fileTable;
+        fileTable = newTable;
+        numFileTables = size;
+    }
+
     bool Create(char *name) {
         int fileDescriptor = OpenForWrite(name);
 
@@ -101,11 +114,20 @@ class FileSystem {
 };
 
 #else  // FILESYS
+#include "disk.h"
+
+// The last tracks of the disk hold the swap area (see SwapSpace).
+// Formatting the disk marks them in use, so they are never given to
+// a file.
+const int NumSwapSectors = 8 * SectorsPerTrack;
+const int FirstSwapSector = NumSectors - NumSwapSectors;
+
 class FileSystem {
    public:
     FileSystem(bool format);  // Initialize the file system.
                               // Must be called *after* "synchDisk"
-                              // has been initialized.
+                              // and "synchCache" have been
+                              // initialized.
                               // If "format", there is nothing on
                               // the disk, so initialize the directory
                               // and the bitmap of free blocks.
@@ -19,6 +19,9 @@ class FileTable {
     FileTable() {
         openFile = new OpenFile*[FILE_MAX];
         fileOpenMode = new int[FILE_MAX];
+        for (int i = 0; i < FILE_MAX; i++) {
+            openFile[i] = NULL;
+        }
         fileOpenMode[CONSOLE_IN] = MODE_READ;
         fileOpenMode[CONSOLE_OUT] = MODE_WRITE;
     }
@@ -16,7 +16,7 @@
 #include "main.h"
 #include "filehdr.h"
 #include "openfile.h"
-#include "synchdisk.h"
+#include "synchcache.h"
 
 //----------------------------------------------------------------------
 // OpenFile::OpenFile
@@ -86,7 +86,8 @@ int OpenFile::Write(char *into, int numBytes) {
 //
 //	For ReadAt:
 //	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
+//	   request, but we only copy the part we are interested in.  Each
+//	   extent of consecutive sectors is read with one disk request.
 //	For WriteAt:
 //	   We must first read in any sectors that will be partially written,
 //	   so that we don't overwrite the unmodified portion.  We then copy
@@ -102,7 +103,7 @@ int OpenFile::Write(char *into, int numBytes) {
 
 int OpenFile::ReadAt(char *into, int numBytes, int position) {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
+    int i, firstSector, lastSector, numSectors, sector, run;
     char *buf;
 
     if ((numBytes <= 0) || (position >= fileLength)) return 0;  // check request
@@ -114,11 +115,14 @@ int OpenFile::ReadAt(char *into, int numBytes, int position) {
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
     numSectors = 1 + lastSector - firstSector;
 
-    // read in all the full and partial sectors that we need
+    // read in all the full and partial sectors that we need, an
+    // extent of consecutive sectors at a time
     buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)
-        kernel->synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize),
-                                      &buf[(i - firstSector) * SectorSize]);
+    for (i = firstSector; i <= lastSector; i += run) {
+        sector = hdr->ByteToExtent(i * SectorSize, lastSector - i + 1, &run);
+        kernel->synchCache->ReadSectors(
+            sector, &buf[(i - firstSector) * SectorSize], run);
+    }
 
     // copy the part we want
     bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
@@ -157,8 +161,8 @@ int OpenFile::WriteAt(char *from, int numBytes, int position) {
 
     // write modified sectors back
     for (i = firstSector; i <= lastSector; i++)
-        kernel->synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize),
-                                       &buf[(i - firstSector) * SectorSize]);
+        kernel->synchCache->WriteSector(hdr->ByteToSector(i * SectorSize),
+                                        &buf[(i - firstSector) * SectorSize]);
     delete[] buf;
     return numBytes;
 }
@@ -69,3 +69,46 @@ void PersistentBitmap::FetchFrom(OpenFile *file) {
 void PersistentBitmap::WriteBack(OpenFile *file) {
     file->WriteAt((char *)map, numWords * sizeof(unsigned), 0);
 }
+
+//----------------------------------------------------------------------
+// PersistentBitmap::FindAndSetRun
+// 	Find a run of clear bits -- free sectors -- that lie on one disk
+//	track, and set up to "numWanted" of them.  The first run long
+//	enough is used; failing that, the longest there is, so that the
+//	caller needs as few runs as possible.  Read back in order, the
+//	sectors of a run pass under the disk head one after the other.
+//
+//	Return the first bit of the run, and its length in "numFound";
+//	-1 if no bits are clear.
+//
+//	"numWanted" is the most sectors the caller wants
+//----------------------------------------------------------------------
+
+int PersistentBitmap::FindAndSetRun(int numWanted, int *numFound) {
+    int best = -1, bestLength = 0;
+    int i = 0, start;
+
+    while (i < numBits && bestLength < numWanted) {
+        if (Test(i)) {
+            i++;
+            continue;
+        }
+        start = i;
+        do {  // to the end of the run, or of the track
+            i++;
+        } while (i < numBits && !Test(i) && (i % SectorsPerTrack) != 0);
+        if (i - start > bestLength) {
+            best = start;
+            bestLength = i - start;
+        }
+    }
+    if (best < 0) {
+        return -1;
+    }
+
+    *numFound = min(bestLength, numWanted);
+    for (i = best; i < best + *numFound; i++) {
+        Mark(i);
+    }
+    return best;
+}
@@ -16,6 +16,7 @@
 #include "copyright.h"
 #include "bitmap.h"
 #include "openfile.h"
+#include "disk.h"
 
 // The following class defines a persistent bitmap.  It inherits all
 // the behavior of a bitmap (see bitmap.h), adding the ability to
@@ -31,6 +32,10 @@ class PersistentBitmap : public Bitmap {
 
     void FetchFrom(OpenFile *file);  // read bitmap from the disk
     void WriteBack(OpenFile *file);  // write bitmap contents to disk
+
+    int FindAndSetRun(int numWanted, int *numFound);
+    // Allocate a run of up to "numWanted"
+    // sectors on one track
 };
 
 #endif  // PBITMAP_H
@@ -0,0 +1,427 @@
+// synchcache.cc
+//	Routines to read and write disk sectors through a buffer cache.
+//	See synchcache.h.
+//
+//	A lock protects the cache.  It is not held while a sector is
+//	being transferred, so other threads can use the rest of the
+//	cache meanwhile; instead the entry is marked busy, and anyone
+//	else wanting it waits for it on a condition variable.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "synchcache.h"
+#include "synchdisk.h"
+#include "main.h"
+
+static int EntrySector(CacheEntry *entry) { return entry->sector; }
+static unsigned SectorHash(int sector) { return (unsigned)sector; }
+
+//----------------------------------------------------------------------
+// SynchCache::SynchCache
+// 	Initialize a cache of "numEntries" sectors of "disk".  Initially,
+//	it holds none.
+//----------------------------------------------------------------------
+
+SynchCache::SynchCache(SynchDisk *disk, int numEntries) {
+    ASSERT(numEntries > 0);
+    this->disk = disk;
+    this->numEntries = numEntries;
+    entries = new CacheEntry[numEntries];
+    for (int i = 0; i < numEntries; i++) {
+        entries[i].sector = -1;
+        entries[i].valid = FALSE;
+        entries[i].dirty = FALSE;
+        entries[i].busy = FALSE;
+        entries[i].prev = (i > 0) ? &entries[i - 1] : NULL;
+        entries[i].next = (i < numEntries - 1) ? &entries[i + 1] : NULL;
+    }
+    lruHead = &entries[0];
+    lruTail = &entries[numEntries - 1];
+    index = new HashTable<int, CacheEntry *>(EntrySector, SectorHash);
+    lock = new Lock("sector cache");
+    ioDone = new Condition("sector cache I/O");
+}
+
+//----------------------------------------------------------------------
+// SynchCache::~SynchCache
+// 	De-allocate the cache.  Anything not flushed by now is lost.
+//----------------------------------------------------------------------
+
+SynchCache::~SynchCache() {
+    delete ioDone;
+    delete lock;
+    delete index;
+    delete[] entries;
+}
+
+//----------------------------------------------------------------------
+// SynchCache::ReadSector
+// 	Copy the contents of a disk sector into "data", reading it from
+//	disk only if it isn't in the cache.
+//
+//	"sectorNumber" -- the disk sector to read
+//	"data" -- the buffer to hold the contents of the disk sector
+//----------------------------------------------------------------------
+
+void SynchCache::ReadSector(int sectorNumber, char *data) {
+    lock->Acquire();
+    CacheEntry *entry = GetEntry(sectorNumber, FALSE);
+    bcopy(entry->data, data, SectorSize);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchCache::WriteSector
+// 	Replace the contents of a disk sector with "data".  The new
+//	contents go in the cache, and are written to disk later.  Since
+//	the whole sector is replaced, the old contents needn't be read.
+//
+//	"sectorNumber" -- the disk sector to be written
+//	"data" -- the new contents of the disk sector
+//----------------------------------------------------------------------
+
+void SynchCache::WriteSector(int sectorNumber, char *data) {
+    lock->Acquire();
+    CacheEntry *entry = GetEntry(sectorNumber, TRUE);
+    bcopy(data, entry->data, SectorSize);
+    entry->dirty = TRUE;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchCache::ReadSectors
+// 	Copy the contents of a run of consecutive sectors on one track
+//	into "data".  Sectors that aren't in the cache are read together,
+//	each run of them in a single disk request, rather than paying
+//	the full latency for each in turn.
+//
+//	"sectorNumber" -- the first disk sector to read
+//	"data" -- the buffer to hold the contents of the disk sectors
+//	"numSectors" -- how many sectors to read
+//----------------------------------------------------------------------
+
+void SynchCache::ReadSectors(int sectorNumber, char *data, int numSectors) {
+    CacheEntry *entry;
+    int i = 0, n;
+    bool found;
+
+    lock->Acquire();
+    while (i < numSectors) {
+        n = LoadRun(sectorNumber + i, numSectors - i);
+        if (n == 0) {  // cached already, or on its way in; or no room
+            entry = GetEntry(sectorNumber + i, FALSE);
+            bcopy(entry->data, &data[i * SectorSize], SectorSize);
+            i++;
+            continue;
+        }
+        // we have held the lock since the run came in, so it is all
+        // still there
+        for (; n > 0; n--, i++) {
+            found = index->Find(sectorNumber + i, &entry);
+            ASSERT(found);
+            bcopy(entry->data, &data[i * SectorSize], SectorSize);
+        }
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchCache::Flush
+// 	Write every dirty sector in the cache to disk.  The sectors stay
+//	in the cache.
+//
+//	The dirty sectors are all handed to the disk at once, so that it
+//	can put them in a good order, and sectors next to each other on
+//	a track are gathered into one request.  Any that are busy to
+//	begin with are waited for, and written afterwards if need be.
+//----------------------------------------------------------------------
+
+void SynchCache::Flush() {
+    bool *flushing = new bool[numEntries];  // entries in this batch
+    DiskRequest **requests = new DiskRequest *[numEntries];
+    Semaphore done("sector cache flush", 0);
+    CacheEntry *entry, *next;
+    int numRequests = 0, length;
+
+    lock->Acquire();
+    for (int i = 0; i < numEntries; i++) {
+        entry = &entries[i];
+        flushing[i] = entry->valid && entry->dirty && !entry->busy;
+        if (flushing[i]) {
+            entry->busy = TRUE;
+            entry->dirty = FALSE;
+        }
+    }
+    for (int i = 0; i < numEntries; i++) {
+        entry = &entries[i];
+        if (!flushing[i] || (entry->sector % SectorsPerTrack != 0 &&
+                             InBatch(entry->sector - 1, flushing))) {
+            continue;  // not in the batch, or not the start of a run
+        }
+        length = 1;
+        while ((entry->sector + length) % SectorsPerTrack != 0 &&
+               InBatch(entry->sector + length, flushing)) {
+            length++;
+        }
+        DiskRequest *request =
+            new DiskRequest(entry->sector, length, NULL, TRUE);
+        request->buffers = new char *[length];
+        for (int j = 0; j < length; j++) {
+            index->Find(entry->sector + j, &next);
+            request->buffers[j] = next->data;
+        }
+        request->done = &done;
+        requests[numRequests++] = request;
+    }
+    if (numRequests > 0) {
+        DEBUG(dbgFile, "Flushing the sector cache in " << numRequests
+                                                       << " requests");
+        lock->Release();
+        disk->Submit(requests, numRequests);
+        for (int i = 0; i < numRequests; i++) {
+            done.P();
+        }
+        lock->Acquire();
+        for (int i = 0; i < numEntries; i++) {
+            if (flushing[i]) {
+                entries[i].busy = FALSE;
+            }
+        }
+        ioDone->Broadcast(lock);
+    }
+    for (int i = 0; i < numRequests; i++) {
+        delete[] requests[i]->buffers;
+        delete requests[i];
+    }
+    delete[] requests;
+    delete[] flushing;
+
+    for (int i = 0; i < numEntries; i++) {
+        while (entries[i].busy) {
+            ioDone->Wait(lock);
+        }
+        if (entries[i].valid && entries[i].dirty) {
+            WriteOut(&entries[i]);
+        }
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchCache::InBatch
+// 	Is "sectorNumber" in the cache, and one of those marked in
+//	"flushing"?
+//----------------------------------------------------------------------
+
+bool SynchCache::InBatch(int sectorNumber, bool *flushing) {
+    CacheEntry *entry;
+
+    return index->Find(sectorNumber, &entry) && flushing[entry - entries];
+}
+
+//----------------------------------------------------------------------
+// SynchCache::StartWriteBack
+// 	Fork a kernel thread to write dirty sectors back every
+//	WriteBackTicks, so that not too much is lost if Nachos dies
+//	without halting.
+//----------------------------------------------------------------------
+
+void SynchCache::StartWriteBack() {
+    Thread *thread = new Thread("write-back");
+
+    thread->Fork(WriteBack, this);
+}
+
+//----------------------------------------------------------------------
+// SynchCache::WriteBack
+// 	The write-back thread: sleep, flush, repeat.
+//----------------------------------------------------------------------
+
+void SynchCache::WriteBack(void *arg) {
+    SynchCache *cache = (SynchCache *)arg;
+
+    for (;;) {
+        kernel->alarm->WaitUntil(WriteBackTicks);
+        DEBUG(dbgFile, "Writing back the sector cache");
+        cache->Flush();
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchCache::GetEntry
+// 	Return the cache entry holding "sectorNumber", having made it the
+//	most recently used.  If the sector isn't in the cache, the least
+//	recently used entry is given over to it (written out first, if
+//	it is dirty), and the sector read in -- unless the caller is
+//	about to "overwrite" all of it.
+//
+//	Called, and returns, with "lock" held; it is released while a
+//	sector is being transferred.
+//----------------------------------------------------------------------
+
+CacheEntry *SynchCache::GetEntry(int sectorNumber, bool overwrite) {
+    CacheEntry *entry;
+
+    ASSERT(sectorNumber >= 0 && sectorNumber < NumSectors);
+    for (;;) {
+        if (index->Find(sectorNumber, &entry)) {
+            if (entry->busy) {  // on its way in or out; wait for it
+                ioDone->Wait(lock);
+                continue;
+            }
+            kernel->stats->numCacheHits++;
+            Touch(entry);
+            return entry;
+        }
+
+        entry = Victim();
+        if (entry == NULL) {  // every entry is busy
+            ioDone->Wait(lock);
+            continue;
+        }
+        if (entry->valid && entry->dirty) {
+            // Write it out, and start again: while we were waiting,
+            // someone else may have brought the sector in.
+            WriteOut(entry);
+            continue;
+        }
+        break;
+    }
+
+    kernel->stats->numCacheMisses++;
+    if (entry->valid) {
+        index->Remove(entry->sector);
+    }
+    entry->sector = sectorNumber;
+    entry->valid = TRUE;
+    entry->dirty = FALSE;
+    index->Insert(entry);
+    Touch(entry);
+    if (!overwrite) {
+        entry->busy = TRUE;
+        lock->Release();
+        disk->ReadSector(sectorNumber, entry->data);
+        lock->Acquire();
+        entry->busy = FALSE;
+        ioDone->Broadcast(lock);
+    }
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// SynchCache::LoadRun
+// 	Give cache entries over to as many of the "numSectors" sectors
+//	from "sectorNumber" on as aren't in the cache, stopping at the
+//	first one that is, and read them all in with one disk request.
+//	Return how many were read; 0 if "sectorNumber" itself is cached,
+//	or every entry is busy.
+//
+//	Called, and returns, with "lock" held; it is released while the
+//	sectors are being transferred, with their entries marked busy.
+//----------------------------------------------------------------------
+
+int SynchCache::LoadRun(int sectorNumber, int numSectors) {
+    CacheEntry **run = new CacheEntry *[numSectors];
+    CacheEntry *entry;
+    char *buf;
+    int n = 0;
+
+    ASSERT(sectorNumber >= 0 && sectorNumber + numSectors <= NumSectors);
+    while (n < numSectors && !index->Find(sectorNumber + n, &entry)) {
+        entry = Victim();
+        if (entry == NULL) {  // every entry is busy; make do
+            break;
+        }
+        if (entry->valid && entry->dirty) {
+            // Write it out, and look again: while we were waiting,
+            // someone else may have brought the sector in.
+            WriteOut(entry);
+            continue;
+        }
+        if (entry->valid) {
+            index->Remove(entry->sector);
+        }
+        entry->sector = sectorNumber + n;
+        entry->valid = TRUE;
+        entry->dirty = FALSE;
+        entry->busy = TRUE;  // so Victim passes over it
+        index->Insert(entry);
+        Touch(entry);
+        run[n++] = entry;
+    }
+
+    if (n > 0) {
+        kernel->stats->numCacheMisses += n;
+        buf = new char[n * SectorSize];
+        lock->Release();
+        disk->ReadSectors(sectorNumber, buf, n);
+        lock->Acquire();
+        for (int i = 0; i < n; i++) {
+            bcopy(&buf[i * SectorSize], run[i]->data, SectorSize);
+            run[i]->busy = FALSE;
+        }
+        ioDone->Broadcast(lock);
+        delete[] buf;
+    }
+    delete[] run;
+    return n;
+}
+
+//----------------------------------------------------------------------
+// SynchCache::Touch
+// 	Make "entry" the most recently used, by moving it to the end of
+//	the LRU list.
+//----------------------------------------------------------------------
+
+void SynchCache::Touch(CacheEntry *entry) {
+    if (entry == lruTail) {
+        return;
+    }
+    if (entry->prev != NULL) {  // take it out...
+        entry->prev->next = entry->next;
+    } else {
+        lruHead = entry->next;
+    }
+    entry->next->prev = entry->prev;
+
+    entry->prev = lruTail;  // ...and put it at the end
+    entry->next = NULL;
+    lruTail->next = entry;
+    lruTail = entry;
+}
+
+//----------------------------------------------------------------------
+// SynchCache::Victim
+// 	Return the least recently used entry that isn't busy, to be given
+//	over to another sector; NULL if they all are.
+//----------------------------------------------------------------------
+
+CacheEntry *SynchCache::Victim() {
+    for (CacheEntry *entry = lruHead; entry != NULL; entry = entry->next) {
+        if (!entry->busy) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// SynchCache::WriteOut
+// 	Write the dirty sector in "entry" to disk.  Called with "lock"
+//	held; it is released during the write, with the entry marked busy
+//	so no one changes it meanwhile.
+//----------------------------------------------------------------------
+
+void SynchCache::WriteOut(CacheEntry *entry) {
+    ASSERT(entry->valid && entry->dirty && !entry->busy);
+    entry->busy = TRUE;
+    entry->dirty = FALSE;
+    lock->Release();
+    disk->WriteSector(entry->sector, entry->data);
+    lock->Acquire();
+    entry->busy = FALSE;
+    ioDone->Broadcast(lock);
+}
@@ -0,0 +1,95 @@
+// synchcache.h
+//	Data structures for a buffer cache of disk sectors, between the
+//	file system and the synchronous disk.
+//
+//	Every file header, directory and bitmap fetch, and every read
+//	or write of a file, is a sector transfer; without a cache, each
+//	one pays the full seek and rotational delay, even for a sector
+//	that was just read.  The cache keeps recently used sectors in
+//	memory, found by a hash on the sector number, and throws out the
+//	least recently used when it needs room.
+//
+//	Writes go to the cache, and reach the disk later ("write-back"):
+//	when the sector is thrown out, when a kernel thread makes its
+//	periodic pass over the cache, or when Nachos halts.  A pass
+//	hands all the dirty sectors to the disk in one batch.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SYNCHCACHE_H
+#define SYNCHCACHE_H
+
+#include "copyright.h"
+#include "disk.h"
+#include "synch.h"
+#include "hash.h"
+
+class SynchDisk;
+
+const int NumCacheSectors = 64;     // sectors the cache can hold
+const int WriteBackTicks = 100000;  // how often dirty sectors are
+                                    // written back
+
+// One sector's worth of the cache.
+
+class CacheEntry {
+   public:
+    int sector;               // which sector it holds, if valid
+    bool valid;               // does it hold a sector at all?
+    bool dirty;               // changed since it was read/written?
+    bool busy;                // being read or written just now?
+    char data[SectorSize];    // the contents of the sector
+    CacheEntry *prev, *next;  // on the LRU list
+};
+
+class SynchCache {
+   public:
+    SynchCache(SynchDisk *disk, int numEntries);
+    // Cache "numEntries" sectors of "disk"
+    ~SynchCache();  // De-allocate the cache; it must
+                    // have been flushed
+
+    void ReadSector(int sectorNumber, char *data);
+    // Read/write a sector through the
+    // cache, going to the disk only for
+    // a sector that isn't there
+    void WriteSector(int sectorNumber, char *data);
+    void ReadSectors(int sectorNumber, char *data, int numSectors);
+    // Read a run of sectors on one track,
+    // fetching the ones that aren't
+    // cached with as few requests as
+    // possible
+
+    void Flush();  // Write every dirty sector to disk
+
+    void StartWriteBack();  // Fork the thread that flushes the
+                            // cache every WriteBackTicks
+
+   private:
+    SynchDisk *disk;                      // where the sectors live
+    int numEntries;                       // how many sectors it holds
+    CacheEntry *entries;                  // the sectors themselves
+    CacheEntry *lruHead;                  // least recently used
+    CacheEntry *lruTail;                  // most recently used
+    HashTable<int, CacheEntry *> *index;  // entries, by sector
+    Lock *lock;                           // protects all of the above
+    Condition *ioDone;  // signalled when an entry stops being busy
+
+    CacheEntry *GetEntry(int sectorNumber, bool overwrite);
+    // Find or load "sectorNumber", with
+    // "lock" held
+    int LoadRun(int sectorNumber, int numSectors);
+    // Load as many of the sectors from
+    // "sectorNumber" on as aren't cached
+    void Touch(CacheEntry *entry);     // Move to the end of the LRU list
+    CacheEntry *Victim();              // Least recently used idle entry
+    void WriteOut(CacheEntry *entry);  // Write a dirty entry to disk
+    bool InBatch(int sectorNumber, bool *flushing);
+    // Is it among those being flushed?
+
+    static void WriteBack(void *arg);  // Body of the write-back thread
+};
+
+#endif  // SYNCHCACHE_H
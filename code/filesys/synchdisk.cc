@@ -5,10 +5,14 @@
 //	the disk providing a synchronous interface (requests wait until
 //	the request completes).
 //
-//	Use a semaphore to synchronize the interrupt handlers with the
-//	pending requests.  And, because the physical disk can only
-//	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	Each request says what the interrupt handler should do when it
+//	is done: call an object back, or signal a semaphore the thread
+//	that made it is waiting on.  And, because the physical disk can
+//	only handle one operation at a time, requests wait their turn in
+//	a queue; when the disk finishes one, the interrupt handler starts
+//	the next.  Since the queue is shared
+//	with the interrupt handler, it is protected by disabling
+//	interrupts, rather than by a lock.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -16,17 +20,26 @@
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "synch.h"
+#include "main.h"
 
 //----------------------------------------------------------------------
 // SynchDisk::SynchDisk
 // 	Initialize the synchronous interface to the physical disk, in turn
 //	initializing the physical disk.
 //
+//	"policy" -- how to order requests waiting for the disk
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk() {
-    semaphore = new Semaphore("synch disk", 0);
-    lock = new Lock("synch disk lock");
+SynchDisk::SynchDisk(DiskPolicy policy) {
+    this->policy = policy;
+    queue = active = NULL;
+    ascending = TRUE;
+    numRequests = maxService = 0;
+    totalService = 0;
+    for (int i = 0; i < DiskHistBuckets; i++) {
+        serviceHist[i] = 0;
+    }
     disk = new Disk(this);
 }
 
@@ -36,11 +49,7 @@ SynchDisk::SynchDisk() {
 //	abstraction.
 //----------------------------------------------------------------------
 
-SynchDisk::~SynchDisk() {
-    delete disk;
-    delete lock;
-    delete semaphore;
-}
+SynchDisk::~SynchDisk() { delete disk; }
 
 //----------------------------------------------------------------------
 // SynchDisk::ReadSector
@@ -52,10 +61,7 @@ SynchDisk::~SynchDisk() {
 //----------------------------------------------------------------------
 
 void SynchDisk::ReadSector(int sectorNumber, char* data) {
-    lock->Acquire();  // only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();  // wait for interrupt
-    lock->Release();
+    ReadSectors(sectorNumber, data, 1);
 }
 
 //----------------------------------------------------------------------
@@ -68,16 +74,242 @@ void SynchDisk::ReadSector(int sectorNumber, char* data) {
 //----------------------------------------------------------------------
 
 void SynchDisk::WriteSector(int sectorNumber, char* data) {
-    lock->Acquire();  // only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();  // wait for interrupt
-    lock->Release();
+    DiskRequest request(sectorNumber, 1, data, TRUE);
+
+    Wait(&request);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors
+// 	Read a run of consecutive sectors on one track into a buffer, as
+//	a single disk request.  Return only after the data has been read.
+//
+//	"sectorNumber" -- the first disk sector to read
+//	"data" -- the buffer to hold the contents of the disk sectors
+//	"numSectors" -- how many sectors to read
+//----------------------------------------------------------------------
+
+void SynchDisk::ReadSectors(int sectorNumber, char* data, int numSectors) {
+    DiskRequest request(sectorNumber, numSectors, data, FALSE);
+
+    Wait(&request);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Wait
+// 	Submit a request, and wait for the interrupt handler to say it
+//	is done.
+//----------------------------------------------------------------------
+
+void SynchDisk::Wait(DiskRequest* request) {
+    Semaphore done("disk request", 0);
+
+    request->done = &done;
+    Submit(request);
+    done.P();  // wait for interrupt
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Submit
+// 	Put a request on the queue, starting it at once if the disk is
+//	idle, and return without waiting for it.  The request says what
+//	to do when it is done.
+//
+//	"request" -- the transfer to make
+//----------------------------------------------------------------------
+
+void SynchDisk::Submit(DiskRequest* request) { Submit(&request, 1); }
+
+//----------------------------------------------------------------------
+// SynchDisk::Submit
+// 	Put a batch of requests on the queue, all at once, so that the
+//	policy can choose among all of them from the start; start the
+//	first if the disk is idle, and return without waiting.
+//
+//	"requests" -- the transfers to make
+//	"numRequests" -- how many there are
+//----------------------------------------------------------------------
+
+void SynchDisk::Submit(DiskRequest** requests, int numRequests) {
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    for (int i = 0; i < numRequests; i++) {
+        Enqueue(requests[i]);
+    }
+    if (active == NULL) {
+        StartNext();
+    }
+    (void)kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Enqueue
+// 	Put a request at the end of the queue.  Called with interrupts
+//	off.
+//----------------------------------------------------------------------
+
+void SynchDisk::Enqueue(DiskRequest* request) {
+    DiskRequest** link = &queue;
+
+    ASSERT(request->numSectors > 0 &&
+           request->numSectors * SectorSize <= (int)sizeof(bounce));
+    request->queuedAt = kernel->stats->totalTicks;
+    request->next = NULL;
+    while (*link != NULL) {  // to the end, so FIFO is first come
+        link = &(*link)->next;
+    }
+    *link = request;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::StartNext
+// 	If any requests are waiting, send the one the policy chooses to
+//	the disk.  Called with interrupts off, when the disk is idle.
+//----------------------------------------------------------------------
+
+void SynchDisk::StartNext() {
+    char* data;
+
+    ASSERT(kernel->interrupt->getLevel() == IntOff && active == NULL);
+    if (queue == NULL) {
+        return;
+    }
+    active = Choose();
+    data = active->data;
+    if (active->buffers != NULL) {  // transfer through "bounce"
+        data = bounce;
+        if (active->writing) {  // gather
+            for (int i = 0; i < active->numSectors; i++) {
+                bcopy(active->buffers[i], &bounce[i * SectorSize],
+                      SectorSize);
+            }
+        }
+    }
+    if (active->writing) {
+        disk->WriteRequest(active->sector, data, active->numSectors);
+    } else {
+        disk->ReadRequest(active->sector, data, active->numSectors);
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Choose
+// 	Take the request that should go to the disk next off the queue,
+//	and return it.  Each request is given a cost according to the
+//	policy, and the cheapest taken; among equals, the one that has
+//	waited longest.
+//
+//	SCAN charges requests behind the head more than any ahead of it,
+//	so it turns around only when there are none ahead.  It turns at
+//	the last request rather than at the edge of the disk, since the
+//	disk has no way to move the head without a transfer.  C-LOOK
+//	counts the distance to requests behind the head as if the tracks
+//	wrapped around, so it goes up to the last, then back to the
+//	lowest.
+//----------------------------------------------------------------------
+
+DiskRequest* SynchDisk::Choose() {
+    DiskRequest **link, **best = NULL;
+    DiskRequest* request;
+    int head = disk->HeadSector() / SectorsPerTrack;
+    int cost, bestCost = 0, distance, rotate;
+
+    for (link = &queue; *link != NULL; link = &(*link)->next) {
+        request = *link;
+        distance = request->sector / SectorsPerTrack - head;
+        switch (policy) {
+            case FifoDisk:
+                cost = 0;
+                break;
+            case ScanDisk:
+                if (!ascending) {
+                    distance = -distance;
+                }
+                cost = (distance >= 0) ? distance : NumTracks - distance;
+                break;
+            case CLookDisk:
+                cost = (distance >= 0) ? distance : NumTracks + distance;
+                break;
+            case SstfDisk:
+                cost = disk->TimeToSeek(request->sector, &rotate) + rotate;
+                break;
+            default:
+                ASSERTNOTREACHED();
+        }
+        if (best == NULL || cost < bestCost) {
+            best = link;
+            bestCost = cost;
+        }
+    }
+
+    request = *best;
+    *best = request->next;
+    if (request->sector / SectorsPerTrack != head) {
+        ascending = (request->sector / SectorsPerTrack > head);
+    }
+    return request;
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::CallBack
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// 	Disk interrupt handler.  Record how long the request took, start
+//	the next one, and tell whoever made this one that it is done.
+//	A scattered read is copied out of "bounce" before the next
+//	request can reuse it.
+//----------------------------------------------------------------------
+
+void SynchDisk::CallBack() {
+    DiskRequest* request = active;
+    int service = kernel->stats->totalTicks - request->queuedAt;
+
+    numRequests++;
+    totalService += service;
+    if (service > maxService) {
+        maxService = service;
+    }
+    serviceHist[min(service / RotationTime, DiskHistBuckets - 1)]++;
+
+    if (request->buffers != NULL && !request->writing) {  // scatter
+        for (int i = 0; i < request->numSectors; i++) {
+            bcopy(&bounce[i * SectorSize], request->buffers[i], SectorSize);
+        }
+    }
+    active = NULL;
+    StartNext();
+
+    // the request may be gone once either of these is done with it
+    Semaphore* done = request->done;
+    if (request->callWhenDone != NULL) {
+        request->callWhenDone->CallBack();
+    }
+    if (done != NULL) {
+        done->V();
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::PrintStats
+// 	Print the mean, 99th percentile and worst time requests took,
+//	from submission to completion, under the policy in use.  The
+//	99th percentile is rounded up to a whole RotationTime.
 //----------------------------------------------------------------------
 
-void SynchDisk::CallBack() { semaphore->V(); }
+void SynchDisk::PrintStats() {
+    static const char *policyNames[] = {"fifo", "scan", "clook", "sstf"};
+    int i, seen = 0, p99;
+
+    if (numRequests == 0) {
+        return;
+    }
+    for (i = 0; i < DiskHistBuckets - 1; i++) {
+        seen += serviceHist[i];
+        if (seen * 100 >= numRequests * 99) {
+            break;
+        }
+    }
+    p99 = min((i + 1) * RotationTime, maxService);
+
+    cout << "Disk queue (" << policyNames[policy] << "): requests "
+         << numRequests << ", service mean " << totalService / numRequests
+         << ", p99 " << p99 << ", max " << maxService << " ticks\n";
+}
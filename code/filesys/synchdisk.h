@@ -12,9 +12,62 @@
 #define SYNCHDISK_H
 
 #include "disk.h"
-#include "synch.h"
 #include "callback.h"
 
+class Semaphore;
+
+// The disk scheduling policies, for choosing which waiting request
+// goes to the disk next.  FIFO takes them in the order they came.
+// SCAN (the "elevator") keeps the head moving one way across the
+// tracks, serving each request as it passes, and turns around when
+// there are none left ahead.  C-LOOK only serves requests on the way
+// up, then goes back to the lowest waiting one and starts again, so
+// that the tracks at either edge don't wait twice as long as the
+// ones in the middle.  SSTF (shortest seek time first) always takes
+// the request nearest the head; it is quickest overall, but can
+// leave a far-off request waiting indefinitely.
+enum DiskPolicy { FifoDisk, ScanDisk, CLookDisk, SstfDisk };
+
+const int DiskHistBuckets = 512;  // service times recorded, to the
+                                  // nearest RotationTime, for p99
+
+// A request to read or write a run of sectors on one track.  The
+// caller fills one in and hands it to SynchDisk::Submit, which
+// returns at once; when the transfer is done, the disk interrupt
+// handler calls "callWhenDone" and signals "done", whichever are set.
+// Since that happens at interrupt time, the callback mustn't block.
+// The request, and the buffers it names, must be left alone until
+// then.
+//
+// The data for the run is normally in one buffer, "data".  To
+// scatter a read into (or gather a write from) separate buffers, one
+// per sector, point "buffers" at them instead.
+
+class DiskRequest {
+   public:
+    DiskRequest(int sectorNumber, int count, char *buffer, bool write) {
+        sector = sectorNumber;
+        numSectors = count;
+        data = buffer;
+        buffers = NULL;
+        writing = write;
+        callWhenDone = NULL;
+        done = NULL;
+        next = NULL;
+    }
+
+    int sector;                 // first sector to transfer
+    int numSectors;             // how many, all on one track
+    char *data;                 // where they come from or go to,
+    char **buffers;             // or, if not NULL, one buffer each
+    bool writing;               // write, rather than read?
+    CallBackObj *callWhenDone;  // called when it completes,
+    Semaphore *done;            // and/or signalled
+
+    int queuedAt;       // when it was submitted; the rest
+    DiskRequest *next;  // is for SynchDisk: next in the queue
+};
+
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
 // requests to read or write portions of the disk return immediately,
@@ -24,32 +77,67 @@
 //
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
-// returning.
+// returning.  Any number of threads can be waiting at once; their
+// requests are queued, and given to the disk one at a time, in the
+// order chosen by the disk scheduling policy.
+//
+// A thread that has other things to do can instead submit requests
+// without waiting for them, a batch at a time if it likes, and be
+// told when each one is done.
 
 class SynchDisk : public CallBackObj {
    public:
-    SynchDisk();   // Initialize a synchronous disk,
-                   // by initializing the raw Disk.
+    SynchDisk(DiskPolicy policy = FifoDisk);
+    // Initialize a synchronous disk,
+    // by initializing the raw Disk.
     ~SynchDisk();  // De-allocate the synch disk data
 
     void ReadSector(int sectorNumber, char *data);
     // Read/write a disk sector, returning
     // only once the data is actually read
-    // or written.  These call
-    // Disk::ReadRequest/WriteRequest and
-    // then wait until the request is done.
+    // or written.  These queue a request
+    // for Disk::ReadRequest/WriteRequest
+    // and then wait until it is done.
     void WriteSector(int sectorNumber, char *data);
+    void ReadSectors(int sectorNumber, char *data, int numSectors);
+    // Read a run of "numSectors" sectors
+    // on one track, in a single request
+
+    void Submit(DiskRequest *request);  // Queue a request, and return
+                                        // without waiting for it
+    void Submit(DiskRequest **requests, int numRequests);
+    // Queue a batch of requests together,
+    // so they can be ordered among
+    // themselves
 
     void CallBack();  // Called by the disk device interrupt
                       // handler, to signal that the
                       // current disk operation is complete.
 
+    void PrintStats();  // Print how long requests took
+
    private:
-    Disk *disk;            // Raw disk device
-    Semaphore *semaphore;  // To synchronize requesting thread
-                           // with the interrupt handler
-    Lock *lock;            // Only one read/write request
-                           // can be sent to the disk at a time
+    Disk *disk;           // Raw disk device
+    DiskPolicy policy;    // how to order the waiting requests
+    DiskRequest *queue;   // requests waiting for the disk
+    DiskRequest *active;  // the request the disk is doing now
+    bool ascending;       // SCAN: is the head moving up?
+
+    int numRequests;                   // requests completed
+    double totalService;               // ticks from submission to
+                                       // completion, over all of them
+    int maxService;                    // longest of them
+    int serviceHist[DiskHistBuckets];  // how many took each time
+    char bounce[SectorsPerTrack * SectorSize];
+    // where a scattered or gathered
+    // request is transferred
+
+    void Enqueue(DiskRequest *request);  // Put a request on the queue
+    void Wait(DiskRequest *request);     // Submit a request, and wait
+                                         // for it to be done
+    void StartNext();                    // Send the next request chosen
+                                         // by the policy to the disk
+    DiskRequest *Choose();               // Take that request off the queue
 };
 
 #endif  // SYNCHDISK_H
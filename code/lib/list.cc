@@ -18,6 +18,11 @@
 
 #include "copyright.h"
 
+// List elements of every type of the same size share an allocator.
+template <class T>
+SlabAllocator *ListElement<T>::slab =
+    SlabAllocator::Find("list element", sizeof(ListElement<T>));
+
 //----------------------------------------------------------------------
 // ListElement<T>::ListElement
 // 	Initialize a list element, so it can be added somewhere on a list.
@@ -0,0 +1,165 @@
+// slab.cc
+//	Routines to manage a slab allocator -- a source of memory for
+//	small objects of one type that are created and deleted often.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "slab.h"
+#include <string.h>
+
+// Every allocator, so that their statistics can be printed.  This is
+// filled in while static objects are being constructed, before main,
+// so it must not need a constructor itself.
+static SlabAllocator *allAllocators = NULL;
+
+//----------------------------------------------------------------------
+// RoundSize
+// 	Return the size of slab object needed to hold "size" bytes.
+//	Every object must be able to hold the free list link, and be
+//	aligned for any type it might contain.
+//----------------------------------------------------------------------
+
+static int RoundSize(int size) {
+    const int align = sizeof(double);
+
+    return divRoundUp(size, align) * align;
+}
+
+//----------------------------------------------------------------------
+// SlabAllocator::SlabAllocator
+// 	Initialize an allocator for objects of "size" bytes, with no
+//	slabs yet.
+//
+//	"debugName" is the name of the type, for the statistics.
+//	"size" is the size of the objects.
+//----------------------------------------------------------------------
+
+SlabAllocator::SlabAllocator(const char *debugName, int size) {
+    name = debugName;
+    objectSize = RoundSize(size);
+    freeList = NULL;
+    numSlabs = numLive = numPeak = numOversized = 0;
+}
+
+//----------------------------------------------------------------------
+// SlabAllocator::Find
+// 	Return the allocator with the given name and object size.  If
+//	there isn't one yet, create it.
+//
+//	This is normally called to initialize a class's static
+//	SlabAllocator pointer, before main starts.
+//----------------------------------------------------------------------
+
+SlabAllocator *SlabAllocator::Find(const char *debugName, int size) {
+    SlabAllocator *slab;
+
+    for (slab = allAllocators; slab != NULL; slab = slab->next) {
+        if (slab->objectSize == RoundSize(size) &&
+            strcmp(slab->name, debugName) == 0) {
+            return slab;
+        }
+    }
+    slab = new SlabAllocator(debugName, size);
+    slab->next = allAllocators;
+    allAllocators = slab;
+    return slab;
+}
+
+//----------------------------------------------------------------------
+// SlabAllocator::Grow
+// 	Get another slab from the host, and put all of its objects on
+//	the free list.
+//----------------------------------------------------------------------
+
+void SlabAllocator::Grow() {
+    char *slab = new char[objectSize * ObjectsPerSlab];
+
+    for (int i = ObjectsPerSlab - 1; i >= 0; i--) {
+        void *object = slab + i * objectSize;
+        *(void **)object = freeList;
+        freeList = object;
+    }
+    numSlabs++;
+}
+
+//----------------------------------------------------------------------
+// SlabAllocator::Alloc
+// 	Return memory for an object, from the free list.  Only when that
+//	is empty do we ask the host for more.
+//
+//	"size" is the size of the object; this is larger than the slab's
+//	objects only for a class derived from the one using the slab.
+//----------------------------------------------------------------------
+
+void *SlabAllocator::Alloc(size_t size) {
+    void *object;
+
+    if ((int)size > objectSize) {
+        numOversized++;
+        return ::operator new(size);
+    }
+    if (freeList == NULL) {
+        Grow();
+    }
+    object = freeList;
+    freeList = *(void **)object;
+    if (++numLive > numPeak) {
+        numPeak = numLive;
+    }
+    return object;
+}
+
+//----------------------------------------------------------------------
+// SlabAllocator::Free
+// 	Put an object that has been deleted back on the free list.
+//
+//	"object" is the memory returned by Alloc.
+//	"size" is the same size that was passed to Alloc.
+//----------------------------------------------------------------------
+
+void SlabAllocator::Free(void *object, size_t size) {
+    if (object == NULL) {
+        return;
+    }
+    if ((int)size > objectSize) {
+        ::operator delete(object);
+        return;
+    }
+    ASSERT(numLive > 0);
+    *(void **)object = freeList;
+    freeList = object;
+    numLive--;
+}
+
+//----------------------------------------------------------------------
+// SlabAllocator::Print
+// 	Print how many objects of this type are in use, how many have
+//	been at the most, and how much memory that took.
+//----------------------------------------------------------------------
+
+void SlabAllocator::Print() {
+    cout << "Slab " << name << ": live " << numLive << ", peak " << numPeak
+         << ", slabs " << numSlabs << " of " << ObjectsPerSlab << " x "
+         << objectSize << " bytes";
+    if (numOversized > 0) {
+        cout << ", oversized " << numOversized;
+    }
+    cout << "\n";
+}
+
+//----------------------------------------------------------------------
+// SlabAllocator::PrintAll
+// 	Print the statistics of every allocator that has been used.
+//----------------------------------------------------------------------
+
+void SlabAllocator::PrintAll() {
+    for (SlabAllocator *slab = allAllocators; slab != NULL; slab = slab->next) {
+        if (slab->numPeak > 0 || slab->numOversized > 0) {
+            slab->Print();
+        }
+    }
+}
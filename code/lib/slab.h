@@ -0,0 +1,80 @@
+// slab.h
+//	Data structures for a slab allocator -- a source of memory for
+//	small objects of one type that are created and deleted often.
+//
+//	Memory is obtained from the host in large chunks ("slabs"), and
+//	carved up into objects.  Deleted objects are kept on a free list,
+//	and handed out again, so once the number of objects of a type has
+//	reached its peak, creating and deleting them no longer calls
+//	the host's malloc or free.  Slabs are never given back.
+//
+//	A class uses a slab allocator by defining its own operator new
+//	and operator delete, for example:
+//
+//	    class Foo {
+//	      public:
+//		void *operator new(size_t size) { return slab->Alloc(size); }
+//		void operator delete(void *p, size_t size) {
+//		    slab->Free(p, size);
+//		}
+//		...
+//	      private:
+//		static SlabAllocator *slab;
+//	    };
+//
+//	    SlabAllocator *Foo::slab = SlabAllocator::Find("foo", sizeof(Foo));
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include "copyright.h"
+#include "utility.h"
+#include <stddef.h>
+
+// The following class defines a slab allocator for objects of a
+// single size.  It keeps count of how many objects are in use, and
+// the most that have ever been, for the statistics.
+
+class SlabAllocator {
+   public:
+    static SlabAllocator *Find(const char *debugName, int size);
+    // Return the allocator called "debugName"
+    // for objects of "size" bytes, creating it
+    // if need be.  Types of the same size can
+    // share an allocator by using the same name.
+
+    void *Alloc(size_t size);  // Return memory for an object
+    void Free(void *object, size_t size);
+    // Put an object back on the free list
+
+    int NumLive() { return numLive; }  // objects in use now
+    int NumPeak() { return numPeak; }  // most objects ever in use
+
+    void Print();            // Print the statistics for this type
+    static void PrintAll();  // Print them for every type used
+
+   private:
+    SlabAllocator(const char *debugName, int size);  // use Find instead
+
+    const char *name;  // for debugging and statistics
+    int objectSize;    // bytes in each object
+    void *freeList;    // objects ready to be handed out, chained
+                       // through their first word
+    int numSlabs;      // slabs obtained from the host
+    int numLive;       // objects handed out and not yet freed
+    int numPeak;       // the largest numLive has ever been
+    int numOversized;  // objects too big for the slab (of a derived
+                       // class), passed on to the host
+
+    SlabAllocator *next;  // next in the list of all allocators
+
+    void Grow();  // Get another slab from the host
+};
+
+const int ObjectsPerSlab = 64;  // number of objects in each slab
+
+#endif  // SLAB_H
@@ -90,7 +90,8 @@ static void PrintSector(bool writing, int sector, char *data) {
 
 //----------------------------------------------------------------------
 // Disk::ReadRequest/WriteRequest
-// 	Simulate a request to read/write a single disk sector
+// 	Simulate a request to read/write a single disk sector, or a run
+//	of consecutive sectors on the same track
 //	   Do the read/write immediately to the UNIX file
 //	   Set up an interrupt handler to be called later,
 //	      that will notify the caller when the simulator says
@@ -99,40 +100,53 @@ static void PrintSector(bool writing, int sector, char *data) {
 //	Note that a disk only allows an entire sector to be read/written,
 //	not part of a sector.
 //
-//	"sectorNumber" -- the disk sector to read/write
+//	"sectorNumber" -- the (first) disk sector to read/write
 //	"data" -- the bytes to be written, the buffer to hold the incoming bytes
+//	"numSectors" -- how many sectors to transfer
 //----------------------------------------------------------------------
 
-void Disk::ReadRequest(int sectorNumber, char *data) {
-    int ticks = ComputeLatency(sectorNumber, FALSE);
+void Disk::ReadRequest(int sectorNumber, char *data, int numSectors) {
+    int ticks = ComputeLatency(sectorNumber, FALSE, numSectors);
 
     ASSERT(!active);  // only one request at a time
     ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((numSectors > 0) &&
+           ((sectorNumber % SectorsPerTrack) + numSectors <= SectorsPerTrack));
 
-    DEBUG(dbgDisk, "Reading from sector " << sectorNumber);
+    DEBUG(dbgDisk, "Reading " << numSectors << " sectors from sector "
+                              << sectorNumber);
     Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
-    if (debug->IsEnabled('d')) PrintSector(FALSE, sectorNumber, data);
+    Read(fileno, data, SectorSize * numSectors);
+    if (debug->IsEnabled('d')) {
+        for (int i = 0; i < numSectors; i++)
+            PrintSector(FALSE, sectorNumber + i, &data[i * SectorSize]);
+    }
 
     active = TRUE;
-    UpdateLast(sectorNumber);
+    UpdateLast(sectorNumber + numSectors - 1);
     kernel->stats->numDiskReads++;
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
 
-void Disk::WriteRequest(int sectorNumber, char *data) {
-    int ticks = ComputeLatency(sectorNumber, TRUE);
+void Disk::WriteRequest(int sectorNumber, char *data, int numSectors) {
+    int ticks = ComputeLatency(sectorNumber, TRUE, numSectors);
 
     ASSERT(!active);
     ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((numSectors > 0) &&
+           ((sectorNumber % SectorsPerTrack) + numSectors <= SectorsPerTrack));
 
-    DEBUG(dbgDisk, "Writing to sector " << sectorNumber);
+    DEBUG(dbgDisk, "Writing " << numSectors << " sectors to sector "
+                              << sectorNumber);
     Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    WriteFile(fileno, data, SectorSize);
-    if (debug->IsEnabled('d')) PrintSector(TRUE, sectorNumber, data);
+    WriteFile(fileno, data, SectorSize * numSectors);
+    if (debug->IsEnabled('d')) {
+        for (int i = 0; i < numSectors; i++)
+            PrintSector(TRUE, sectorNumber + i, &data[i * SectorSize]);
+    }
 
     active = TRUE;
-    UpdateLast(sectorNumber);
+    UpdateLast(sectorNumber + numSectors - 1);
     kernel->stats->numDiskWrites++;
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
@@ -205,10 +219,13 @@ int Disk::ModuloDiff(int to, int from) {
 //   	read requests to the current track to be satisfied more quickly.
 //   	The contents of the track buffer are discarded after every seek to
 //   	a new track.
+//
+//	The rest of a run of "numSectors" sectors passes under the head
+//	straight after the first, at one sector per RotationTime.
 //----------------------------------------------------------------------
 
-int Disk::ComputeLatency(int newSector, bool writing) {
-    int rotation;
+int Disk::ComputeLatency(int newSector, bool writing, int numSectors) {
+    int rotation, transfer;
     int seek = TimeToSeek(newSector, &rotation);
     int timeAfter = kernel->stats->totalTicks + seek + rotation;
 
@@ -217,15 +234,17 @@ int Disk::ComputeLatency(int newSector, bool writing) {
     if ((writing == FALSE) && (seek == 0) &&
         (((timeAfter - bufferInit) / RotationTime) >
          ModuloDiff(newSector, bufferInit / RotationTime))) {
-        DEBUG(dbgDisk, "Request latency = " << RotationTime);
-        return RotationTime;  // time to transfer sector from the track buffer
+        DEBUG(dbgDisk, "Request latency = " << numSectors * RotationTime);
+        return numSectors * RotationTime;  // time to transfer sectors from
+                                           // the track buffer
     }
 #endif
 
     rotation += ModuloDiff(newSector, timeAfter / RotationTime) * RotationTime;
+    transfer = numSectors * RotationTime;
 
-    DEBUG(dbgDisk, "Request latency = " << (seek + rotation + RotationTime));
-    return (seek + rotation + RotationTime);
+    DEBUG(dbgDisk, "Request latency = " << (seek + rotation + transfer));
+    return (seek + rotation + transfer);
 }
 
 //----------------------------------------------------------------------
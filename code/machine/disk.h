@@ -60,21 +60,27 @@ class Disk : public CallBackObj {
                                 // when each request completes.
     ~Disk();                    // Deallocate the disk.
 
-    void ReadRequest(int sectorNumber, char *data);
-    // Read/write an single disk sector.
-    // These routines send a request to
-    // the disk and return immediately.
+    void ReadRequest(int sectorNumber, char *data, int numSectors = 1);
+    // Read/write a disk sector, or a run
+    // of "numSectors" sectors within one
+    // track.  These routines send a
+    // request to the disk and return
+    // immediately.
     // Only one request allowed at a time!
-    void WriteRequest(int sectorNumber, char *data);
+    void WriteRequest(int sectorNumber, char *data, int numSectors = 1);
 
     void CallBack();  // Invoked when disk request
                       // finishes. In turn calls, callWhenDone.
 
-    int ComputeLatency(int newSector, bool writing);
+    int ComputeLatency(int newSector, bool writing, int numSectors = 1);
     // Return how long a request to
     // newSector will take:
     // (seek + rotational delay + transfer)
 
+    int TimeToSeek(int newSector, int *rotate);  // time to get to the new track
+    int HeadSector() { return lastSector; }      // where the head is now,
+                                                 // for disk scheduling
+
    private:
     int fileno;                 // UNIX file number for simulated disk
     char diskname[32];          // name of simulated disk's file
@@ -84,7 +90,6 @@ class Disk : public CallBackObj {
     int bufferInit;             // When the track buffer started
                                 // being loaded
 
-    int TimeToSeek(int newSector, int *rotate);  // time to get to the new track
     int ModuloDiff(int to, int from);  // # sectors between to and from
     void UpdateLast(int newSector);
 };
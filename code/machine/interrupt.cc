@@ -23,6 +23,31 @@
 #include "copyright.h"
 #include "interrupt.h"
 #include "main.h"
+#include "synch.h"
+#include "frametable.h"
+#include "synchcache.h"
+#include "synchdisk.h"
+#include <climits>
+
+//----------------------------------------------------------------------
+// ChargeUserTicks
+// 	Charge user time to the process whose instructions are running,
+//	for the per-process statistics.
+//----------------------------------------------------------------------
+
+static void ChargeUserTicks(int ticks) {
+    Thread *thread = kernel->currentThread;
+
+    if (thread->usage == NULL) {  // first time it runs user code
+        thread->usage =
+            kernel->stats->NewProcess(thread->getName(), thread->processID);
+    }
+    thread->usage->userTicks += ticks;
+    thread->usage->tickets = thread->tickets;
+}
+
+SlabAllocator *PendingInterrupt::slab =
+    SlabAllocator::Find("pending interrupt", sizeof(PendingInterrupt));
 
 // String definitions for debugging messages
 
@@ -38,18 +63,22 @@ static char *intTypeNames[] = {"timer",        "disk",         "console write",
 //	"callOnInt" is the object to call when the interrupt occurs
 //	"time" is when (in simulated time) the interrupt is to occur
 //	"kind" is the hardware device that generated the interrupt
+//	"seq" orders interrupts that are to occur at the same time
 //----------------------------------------------------------------------
 
 PendingInterrupt::PendingInterrupt(CallBackObj *callOnInt, int time,
-                                   IntType kind) {
+                                   IntType kind, unsigned int seq) {
     callOnInterrupt = callOnInt;
     when = time;
     type = kind;
+    sequence = seq;
 }
 
 //----------------------------------------------------------------------
 // PendingCompare
 //	Compare to interrupts based on which should occur first.
+//	Interrupts that are due at the same time occur in the order
+//	they were scheduled.
 //----------------------------------------------------------------------
 
 static int PendingCompare(PendingInterrupt *x, PendingInterrupt *y) {
@@ -58,7 +87,7 @@ static int PendingCompare(PendingInterrupt *x, PendingInterrupt *y) {
     } else if (x->when > y->when) {
         return 1;
     } else {
-        return 0;
+        return (int)(x->sequence - y->sequence);  // wraps around safely
     }
 }
 
@@ -71,7 +100,10 @@ static int PendingCompare(PendingInterrupt *x, PendingInterrupt *y) {
 
 Interrupt::Interrupt() {
     level = IntOff;
-    pending = new SortedList<PendingInterrupt *>(PendingCompare);
+    maxPending = 16;  // grows as needed
+    pending = new PendingInterrupt *[maxPending];
+    numPending = 0;
+    numScheduled = 0;
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
@@ -83,10 +115,10 @@ Interrupt::Interrupt() {
 //----------------------------------------------------------------------
 
 Interrupt::~Interrupt() {
-    while (!pending->IsEmpty()) {
-        delete pending->RemoveFront();
+    while (numPending > 0) {
+        delete pending[--numPending];
     }
-    delete pending;
+    delete[] pending;
 }
 
 //----------------------------------------------------------------------
@@ -150,6 +182,7 @@ void Interrupt::OneTick() {
     } else {
         stats->totalTicks += UserTick;
         stats->userTicks += UserTick;
+        ChargeUserTicks(UserTick);
     }
     DEBUG(dbgInt, "== Tick " << stats->totalTicks << " ==");
 
@@ -158,7 +191,6 @@ void Interrupt::OneTick() {
                                  // (interrupt handlers run with
                                  // interrupts disabled)
     CheckIfDue(FALSE);           // check for pending interrupts
-    kernel->scheduler->WakeUp();
     ChangeLevel(IntOff, IntOn);  // re-enable interrupts
     if (yieldOnReturn) {         // if the timer device handler asked
                                  // for a context switch, ok to do it now
@@ -169,6 +201,47 @@ void Interrupt::OneTick() {
     }
 }
 
+//----------------------------------------------------------------------
+// Interrupt::QuietTicks
+// 	Return the number of user instruction ticks that can go by before
+//	OneTick would have anything to do, because no pending interrupt
+//	comes due on any of them.  The machine uses this to run user
+//	instructions without calling OneTick after each one (see
+//	Machine::AdvanceClock).
+//
+//	Returns zero when ticks are being traced, so that the debugging
+//	output shows every tick.
+//----------------------------------------------------------------------
+
+int Interrupt::QuietTicks() {
+    int quiet = INT_MAX;
+
+    if (yieldOnReturn || debug->IsEnabled(dbgInt)) return 0;
+    if (numPending > 0) {
+        quiet = (pending[0]->when - kernel->stats->totalTicks) / UserTick -
+                1;  // ticks before the next interrupt is due
+    }
+    return (quiet > 0) ? quiet : 0;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::SkipTicks
+// 	Advance simulated time by several user ticks at once.  The caller
+//	guarantees (see QuietTicks) that OneTick would have done nothing
+//	else on any of them.
+//
+//	"ticks" -- the number of user instructions that were executed
+//----------------------------------------------------------------------
+
+void Interrupt::SkipTicks(int ticks) {
+    Statistics *stats = kernel->stats;
+
+    ASSERT(status == UserMode);
+    stats->totalTicks += ticks * UserTick;
+    stats->userTicks += ticks * UserTick;
+    ChargeUserTicks(ticks * UserTick);
+}
+
 //----------------------------------------------------------------------
 // Interrupt::YieldOnReturn
 // 	Called from within an interrupt handler, to cause a context switch
@@ -221,8 +294,18 @@ void Interrupt::Idle() {
 // 	Shut down Nachos cleanly, printing out performance statistics.
 //----------------------------------------------------------------------
 void Interrupt::Halt() {
+    if (kernel->synchCache != NULL) {
+        kernel->synchCache->Flush();  // before the disk goes away
+    }
     cout << "Machine halting!\n\n";
     kernel->stats->Print();
+    Lock::PrintStats();
+    if (kernel->synchDisk != NULL) {
+        kernel->synchDisk->PrintStats();
+    }
+    if (debug->IsEnabled(dbgAddr)) {
+        kernel->frameTable->Print();  // what was left in memory
+    }
     delete kernel;  // Never returns.
 }
 
@@ -231,7 +314,8 @@ void Interrupt::Halt() {
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: put it on a binary heap ordered by when it is
+//	due, so this takes O(log n) time for n pending interrupts.
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
@@ -243,13 +327,89 @@ void Interrupt::Halt() {
 //----------------------------------------------------------------------
 void Interrupt::Schedule(CallBackObj *toCall, int fromNow, IntType type) {
     int when = kernel->stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(toCall, when, type);
+    PendingInterrupt *toOccur =
+        new PendingInterrupt(toCall, when, type, numScheduled++);
 
     DEBUG(dbgInt, "Scheduling interrupt handler the " << intTypeNames[type]
                                                       << " at time = " << when);
     ASSERT(fromNow > 0);
 
-    pending->Insert(toOccur);
+    if (numPending == maxPending) {  // out of room, double the heap
+        PendingInterrupt **bigger = new PendingInterrupt *[2 * maxPending];
+
+        memcpy(bigger, pending, numPending * sizeof(PendingInterrupt *));
+        delete[] pending;
+        pending = bigger;
+        maxPending *= 2;
+    }
+    pending[numPending] = toOccur;
+    SiftUp(numPending++);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::RemoveFront
+// 	Remove the interrupt that is due first from the heap, and
+//	return it.  The caller is responsible for deleting it.
+//----------------------------------------------------------------------
+
+PendingInterrupt *Interrupt::RemoveFront() {
+    PendingInterrupt *front = pending[0];
+
+    ASSERT(numPending > 0);
+    pending[0] = pending[--numPending];
+    if (numPending > 0) {
+        SiftDown(0);
+    }
+    return front;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::SiftUp
+// 	Move pending[i] towards the root of the heap until its parent
+//	is due before it.
+//----------------------------------------------------------------------
+
+void Interrupt::SiftUp(int i) {
+    PendingInterrupt *item = pending[i];
+
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+
+        if (PendingCompare(pending[parent], item) <= 0) {
+            break;
+        }
+        pending[i] = pending[parent];
+        i = parent;
+    }
+    pending[i] = item;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::SiftDown
+// 	Move pending[i] away from the root of the heap until both its
+//	children are due after it.
+//----------------------------------------------------------------------
+
+void Interrupt::SiftDown(int i) {
+    PendingInterrupt *item = pending[i];
+
+    for (;;) {
+        int child = 2 * i + 1;
+
+        if (child >= numPending) {
+            break;
+        }
+        if (child + 1 < numPending &&
+            PendingCompare(pending[child + 1], pending[child]) < 0) {
+            child++;  // the right child is due first
+        }
+        if (PendingCompare(item, pending[child]) <= 0) {
+            break;
+        }
+        pending[i] = pending[child];
+        i = child;
+    }
+    pending[i] = item;
 }
 
 //----------------------------------------------------------------------
@@ -273,10 +433,10 @@ bool Interrupt::CheckIfDue(bool advanceClock) {
     if (debug->IsEnabled(dbgInt)) {
         DumpState();
     }
-    if (pending->IsEmpty()) {  // no pending interrupts
+    if (numPending == 0) {  // no pending interrupts
         return FALSE;
     }
-    next = pending->Front();
+    next = pending[0];
     if (next->when > stats->totalTicks) {
         if (!advanceClock) {  // not time yet
             return FALSE;
@@ -296,11 +456,10 @@ bool Interrupt::CheckIfDue(bool advanceClock) {
 
     inHandler = TRUE;
     do {
-        next = pending->RemoveFront();      // pull interrupt off list
+        next = RemoveFront();               // pull interrupt off heap
         next->callOnInterrupt->CallBack();  // call the interrupt handler
         delete next;
-    } while (!pending->IsEmpty() &&
-             (pending->Front()->when <= stats->totalTicks));
+    } while (numPending > 0 && (pending[0]->when <= stats->totalTicks));
     inHandler = FALSE;
     return TRUE;
 }
@@ -323,9 +482,14 @@ static void PrintPending(PendingInterrupt *pending) {
 //----------------------------------------------------------------------
 
 void Interrupt::DumpState() {
+    SortedList<PendingInterrupt *> sorted(PendingCompare);
+
+    for (int i = 0; i < numPending; i++) {  // print them in order
+        sorted.Insert(pending[i]);
+    }
     cout << "Time: " << kernel->stats->totalTicks;
     cout << ", interrupts " << intLevelNames[level] << "\n";
     cout << "Pending interrupts:\n";
-    pending->Apply(PrintPending);
+    sorted.Apply(PrintPending);
     cout << "\nEnd of pending interrupts\n";
 }
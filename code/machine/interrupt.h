@@ -60,10 +60,14 @@ enum IntType {
 // The following class defines an interrupt that is scheduled
 // to occur in the future.  The internal data structures are
 // left public to make it simpler to manipulate.
+//
+// PendingInterrupts come from a slab allocator, so that scheduling an
+// interrupt does not normally need to ask the host for memory.
 
 class PendingInterrupt {
    public:
-    PendingInterrupt(CallBackObj *callOnInt, int time, IntType kind);
+    PendingInterrupt(CallBackObj *callOnInt, int time, IntType kind,
+                     unsigned int seq);
     // initialize an interrupt that will
     // occur in the future
 
@@ -73,6 +77,15 @@ class PendingInterrupt {
 
     int when;      // When the interrupt is supposed to fire
     IntType type;  // for debugging
+    unsigned int sequence;  // order in which interrupts were scheduled;
+                            // those due at the same time fire in this
+                            // order
+
+    void *operator new(size_t size) { return slab->Alloc(size); }
+    void operator delete(void *p, size_t size) { slab->Free(p, size); }
+
+   private:
+    static SlabAllocator *slab;  // where pending interrupts come from
 };
 
 // The following class defines the data structures for the simulation
@@ -122,11 +135,20 @@ class Interrupt {
 
     void OneTick();  // Advance simulated time
 
+    int QuietTicks();  // How many user ticks can pass before
+                       // anything can happen?
+    void SkipTicks(int ticks);
+    // Advance simulated time by user ticks
+    // on which nothing can happen
+
    private:
     IntStatus level;  // are interrupts enabled or disabled?
-    SortedList<PendingInterrupt *> *pending;
-    // the list of interrupts scheduled
-    // to occur in the future
+    PendingInterrupt **pending;  // the interrupts scheduled to occur
+                                 // in the future, kept as a binary
+                                 // min-heap ordered by "when"
+    int numPending;              // number of interrupts in the heap
+    int maxPending;              // size of the "pending" array
+    unsigned int numScheduled;   // sequence number of the next interrupt
     bool inHandler;        // TRUE if we are running an interrupt handler
     bool yieldOnReturn;    // TRUE if we are to context switch
                            // on return from the interrupt handler
@@ -140,6 +162,11 @@ class Interrupt {
 
     void ChangeLevel(IntStatus old,   // SetLevel, without advancing the
                      IntStatus now);  // simulated time
+
+    PendingInterrupt *RemoveFront();  // take the earliest interrupt
+                                      // off the heap
+    void SiftUp(int i);    // restore the heap order, after
+    void SiftDown(int i);  // pending[i] moved
 };
 
 #endif  // INTERRRUPT_H
@@ -52,14 +52,24 @@ static void CheckEndian() {
 //
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed.
+//	"engine" -- how user instructions are to be executed
+//	"batch" -- if TRUE, account for simulated time in batches of
+//		ticks, up to the next time something can happen
 //----------------------------------------------------------------------
 
-Machine::Machine(bool debug) {
+Machine::Machine(bool debug, SimEngine engine, bool batch) {
     int i;
 
     for (i = 0; i < NumTotalRegs; i++) registers[i] = 0;
     mainMemory = new char[MemorySize];
     for (i = 0; i < MemorySize; i++) mainMemory[i] = 0;
+    decodeCache = new Instruction[MemorySize / 4];
+    for (i = 0; i < MemorySize / 4; i++) decodeCache[i].opCode = 0;
+    decodedPage = new bool[NumPhysPages];
+    for (i = 0; i < NumPhysPages; i++) decodedPage[i] = FALSE;
+    translationCache = new CachedTranslation[TranslationCacheSize];
+    for (i = 0; i < TranslationCacheSize; i++)
+        translationCache[i].virtualPage = -1;
 #ifdef USE_TLB
     tlb = new TranslationEntry[TLBSize];
     for (i = 0; i < TLBSize; i++) tlb[i].valid = FALSE;
@@ -70,6 +80,13 @@ Machine::Machine(bool debug) {
 #endif
 
     singleStep = debug;
+    this->engine = engine;
+    dispatchTable = NULL;
+    checkStore = -1;
+    translationEpoch = 0;
+    batchTicks = batch;
+    quietTicks = 0;
+    pendingTicks = 0;
     CheckEndian();
 }
 
@@ -80,6 +97,9 @@ Machine::Machine(bool debug) {
 
 Machine::~Machine() {
     delete[] mainMemory;
+    delete[] decodeCache;
+    delete[] decodedPage;
+    delete[] translationCache;
     if (tlb != NULL) delete[] tlb;
 }
 
@@ -98,6 +118,9 @@ void Machine::RaiseException(ExceptionType which, int badVAddr) {
 
     registers[BadVAddrReg] = badVAddr;
     DelayedLoad(0, 0);  // finish anything in progress
+    translationEpoch++;  // the kernel may change the page table
+    FlushTicks();        // the kernel must see the right time...
+    quietTicks = 0;      // ...and may schedule new interrupts
     kernel->interrupt->setStatus(SystemMode);
     ExceptionHandler(which);  // interrupts are enabled at this point
     kernel->interrupt->setStatus(UserMode);
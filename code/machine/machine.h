@@ -39,6 +39,8 @@ const int NumPhysPages = 128;
 
 const int MemorySize = (NumPhysPages * PageSize);
 const int TLBSize = 4;  // if there is a TLB, make it small
+const int TranslationCacheSize = 16;  // recent translations kept by
+                                      // the simulator itself
 
 enum ExceptionType {
     NoException,            // Everything ok!
@@ -89,13 +91,59 @@ enum ExceptionType {
 // The procedures in this class are defined in machine.cc, mipssim.cc, and
 // translate.cc.
 
-class Instruction;
 class Interrupt;
 
+// The following class defines an instruction, represented in both
+// 	undecoded binary form
+//      decoded to identify
+//	    operation to do
+//	    registers to act on
+//	    any immediate operand value
+//
+// Decoded instructions are cached by the machine, one per word of
+// physical memory, so that an instruction is only decoded the first
+// time it is executed from a given physical address.
+
+class Instruction {
+   public:
+    void Decode();  // decode the binary representation of the instruction
+
+    unsigned int value;  // binary representation of the instruction
+
+    char opCode;      // Type of instruction.  This is NOT the same as the
+                      // opcode field from the instruction: see defs in mips.h
+                      // Zero means "not yet decoded".
+    unsigned char rs, rt, rd;  // Three registers from instruction.
+    int extra;        // Immediate or target or shamt field or offset.
+                      // Immediates are sign-extended.
+
+    void *handler;  // Where the threaded engine executes this
+                    // instruction; resolved when it is decoded.
+    short blockLength;  // Number of instructions from this one to the
+                        // end of its basic block, or zero if the block
+                        // has not been translated yet.
+};
+
+const int InstrsPerPage = PageSize / 4;  // decoded instructions per page
+
+// The ways the simulator can execute user instructions.  All of them
+// give the same results; they differ only in how fast they run on the
+// host.
+
+enum SimEngine {
+    SwitchEngine,    // dispatch through a switch statement (OneInstruction)
+    ThreadedEngine,  // direct-threaded dispatch (RunThreaded)
+    BlockEngine,     // threaded, running whole basic blocks without
+                     // re-translating the PC for each instruction
+    CheckedEngine    // threaded, but every instruction is checked
+                     // against the switch engine; for debugging
+};
+
 class Machine {
    public:
-    Machine(bool debug);  // Initialize the simulation of the hardware
-                          // for running user programs
+    Machine(bool debug, SimEngine engine = SwitchEngine, bool batch = FALSE);
+    // Initialize the simulation of the hardware
+    // for running user programs
     ~Machine();           // De-allocate the data structures
 
     // Routines callable by the Nachos kernel
@@ -145,13 +193,49 @@ class Machine {
     // Read or write 1, 2, or 4 bytes of virtual
     // memory (at addr).  Return FALSE if a
     // correct translation couldn't be found.
+
+    void InvalidateDecodedPage(int physPage);
+    // Discard any predecoded instructions
+    // for a physical page.  The kernel must
+    // call this whenever it changes the
+    // contents of a page frame directly
+    // (e.g., loading or copying a page).
+
+    void InvalidateTranslations();
+    // The mapping from virtual to physical
+    // pages has changed; the kernel must call
+    // this whenever it switches page tables,
+    // changes a page table or TLB entry, or
+    // clears a use or dirty bit.
    private:
     // Routines internal to the machine simulation -- DO NOT call these directly
     void DelayedLoad(int nextReg, int nextVal);
     // Do a pending delayed load (modifying a reg)
 
-    void OneInstruction(Instruction *instr);
+    void OneInstruction();
     // Run one instruction of a user program.
+    void AdvanceClock();
+    // Let time pass after an instruction.
+    void FlushTicks();
+    // Account for ticks skipped by AdvanceClock.
+    void TraceInstruction(Instruction *instr);
+    // Print an instruction, for debugging.
+    void RunThreaded();
+    // Run a user program with the threaded
+    // engine; never returns.
+    Instruction *ThreadedFetch();
+    void CompleteInstruction(int nextLoadReg, int nextLoadValue, int pcAfter);
+    void CrossCheck();
+    // Helpers for RunThreaded.
+    Instruction *FetchInstruction();
+    // Return the decoded instruction at the
+    // PC, or NULL if the fetch trapped.
+    Instruction *DecodedInstruction(int physAddr);
+    // Return the decoded instruction at a
+    // physical address, decoding if needed.
+    void TranslateBlock(Instruction *entry);
+    // Find the end of the basic block that
+    // starts with "entry".
 
     ExceptionType Translate(int virtAddr, int *physAddr, int size,
                             bool writing);
@@ -160,6 +244,10 @@ class Machine {
     // the translation entry appropriately,
     // and return an exception code if the
     // translation couldn't be completed.
+    int CachedTranslate(int virtAddr, int size, bool writing);
+    void CacheTranslation(int virtAddr, int physAddr, bool writing);
+    // Look up or remember a translation that
+    // has already been checked by Translate.
 
     void RaiseException(ExceptionType which, int badVAddr);
     // Trap to the Nachos kernel, because of a
@@ -177,6 +265,32 @@ class Machine {
     int runUntilTime;  // drop back into the debugger when simulated
                        // time reaches this value
 
+    Instruction *decodeCache;  // predecoded instructions, one slot per
+                               // word of physical memory
+    bool *decodedPage;         // does the page frame have any
+                               // predecoded instructions?
+
+    SimEngine engine;                  // how to execute user instructions
+    CachedTranslation *translationCache;  // recently used translations,
+                                          // indexed by virtual page #
+    bool batchTicks;   // account for time in batches of ticks?
+    int quietTicks;    // ticks that can still pass before anything
+                       // can happen (interrupt, wake up)
+    int pendingTicks;  // ticks passed but not yet accounted for
+
+    int translationEpoch;              // bumped whenever virtual to
+                                       // physical translations or
+                                       // decoded instructions may have
+                                       // changed
+    void **dispatchTable;              // handler for each opcode, once
+                                       // the threaded engine has started
+    int checkRegisters[NumTotalRegs];  // registers before the current
+                                       // instruction, for CrossCheck
+    int checkStore;                    // word of physical memory the
+                                       // current instruction stored to,
+                                       // or -1, for CrossCheck
+    unsigned int checkStoreWord;       // what that word held before
+
     friend class Interrupt;  // calls DelayedLoad()
 };
 
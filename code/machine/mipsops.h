@@ -0,0 +1,553 @@
+// mipsops.h
+//	What each MIPS instruction does, for the two simulation engines
+//	in mipssim.cc: the switch in Machine::OneInstruction, and the
+//	direct-threaded handlers in Machine::RunThreaded.  Keeping the
+//	one copy here means the engines can't disagree.
+//
+//	This is not an ordinary header: it is included in the middle of
+//	each engine, which first defines
+//
+//	  CASE(op)  -- the start of the code for opcode "op"
+//	  NEXT()    -- the instruction completed; go on to the next
+//	  TRAP()    -- the instruction trapped to the kernel (which has
+//	               already been called); give up on it
+//
+//	The code uses the engine's "instr", "pcAfter", "nextLoadReg" and
+//	"nextLoadValue", and the scratch variables "sum", "diff", "tmp",
+//	"value", "rs", "rt", "imm" and (with SIM_FIX) "byte".  A case
+//	without NEXT or TRAP falls through into the one after it.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+// Execute the instruction (cf. Kane's book)
+
+CASE(OP_ADD)
+    sum = registers[instr->rs] + registers[instr->rt];
+    if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
+        ((registers[instr->rs] ^ sum) & SIGN_BIT)) {
+        RaiseException(OverflowException, 0);
+        TRAP();
+    }
+    registers[instr->rd] = sum;
+    NEXT();
+
+CASE(OP_ADDI)
+    sum = registers[instr->rs] + instr->extra;
+    if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
+        ((instr->extra ^ sum) & SIGN_BIT)) {
+        RaiseException(OverflowException, 0);
+        TRAP();
+    }
+    registers[instr->rt] = sum;
+    NEXT();
+
+CASE(OP_ADDIU)
+    registers[instr->rt] = registers[instr->rs] + instr->extra;
+    NEXT();
+
+CASE(OP_ADDU)
+    registers[instr->rd] = registers[instr->rs] + registers[instr->rt];
+    NEXT();
+
+CASE(OP_AND)
+    registers[instr->rd] = registers[instr->rs] & registers[instr->rt];
+    NEXT();
+
+CASE(OP_ANDI)
+    registers[instr->rt] =
+        registers[instr->rs] & (instr->extra & 0xffff);
+    NEXT();
+
+CASE(OP_BEQ)
+    if (registers[instr->rs] == registers[instr->rt])
+        pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+    NEXT();
+
+CASE(OP_BGEZAL)
+    registers[R31] = registers[NextPCReg] + 4;
+CASE(OP_BGEZ)
+    if (!(registers[instr->rs] & SIGN_BIT))
+        pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+    NEXT();
+
+CASE(OP_BGTZ)
+    if (registers[instr->rs] > 0)
+        pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+    NEXT();
+
+CASE(OP_BLEZ)
+    if (registers[instr->rs] <= 0)
+        pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+    NEXT();
+
+CASE(OP_BLTZAL)
+    registers[R31] = registers[NextPCReg] + 4;
+CASE(OP_BLTZ)
+    if (registers[instr->rs] & SIGN_BIT)
+        pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+    NEXT();
+
+CASE(OP_BNE)
+    if (registers[instr->rs] != registers[instr->rt])
+        pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+    NEXT();
+
+CASE(OP_DIV)
+    if (registers[instr->rt] == 0) {
+        registers[LoReg] = 0;
+        registers[HiReg] = 0;
+        // cout << "Got divide by zero exception\n";
+        RaiseException(IllegalInstrException, 1);
+        // while catching use type 8
+        TRAP();
+    } else {
+        registers[LoReg] = registers[instr->rs] / registers[instr->rt];
+        registers[HiReg] = registers[instr->rs] % registers[instr->rt];
+    }
+    NEXT();
+
+CASE(OP_DIVU)
+    rs = (unsigned int)registers[instr->rs];
+    rt = (unsigned int)registers[instr->rt];
+    if (rt == 0) {
+        registers[LoReg] = 0;
+        registers[HiReg] = 0;
+        // cout << "Got divide by zero exception\n";
+        RaiseException(IllegalInstrException, 1);
+        // while catching use type 8
+        TRAP();
+    } else {
+        tmp = rs / rt;
+        registers[LoReg] = (int)tmp;
+        tmp = rs % rt;
+        registers[HiReg] = (int)tmp;
+    }
+    NEXT();
+
+CASE(OP_JAL)
+    registers[R31] = registers[NextPCReg] + 4;
+CASE(OP_J)
+    pcAfter = (pcAfter & 0xf0000000) | IndexToAddr(instr->extra);
+    NEXT();
+
+CASE(OP_JALR)
+    registers[instr->rd] = registers[NextPCReg] + 4;
+CASE(OP_JR)
+    pcAfter = registers[instr->rs];
+    NEXT();
+
+CASE(OP_LB)
+CASE(OP_LBU)
+    tmp = registers[instr->rs] + instr->extra;
+    if (!ReadMem(tmp, 1, &value)) TRAP();
+
+    if ((value & 0x80) && (instr->opCode == OP_LB))
+        value |= 0xffffff00;
+    else
+        value &= 0xff;
+    nextLoadReg = instr->rt;
+    nextLoadValue = value;
+    NEXT();
+
+CASE(OP_LH)
+CASE(OP_LHU)
+    tmp = registers[instr->rs] + instr->extra;
+    if (tmp & 0x1) {
+        RaiseException(AddressErrorException, tmp);
+        TRAP();
+    }
+    if (!ReadMem(tmp, 2, &value)) TRAP();
+
+    if ((value & 0x8000) && (instr->opCode == OP_LH))
+        value |= 0xffff0000;
+    else
+        value &= 0xffff;
+    nextLoadReg = instr->rt;
+    nextLoadValue = value;
+    NEXT();
+
+CASE(OP_LUI)
+    DEBUG(dbgMach,
+          "Executing: LUI r" << instr->rt << ", " << instr->extra);
+    registers[instr->rt] = instr->extra << 16;
+    NEXT();
+
+CASE(OP_LW)
+    tmp = registers[instr->rs] + instr->extra;
+    if (tmp & 0x3) {
+        RaiseException(AddressErrorException, tmp);
+        TRAP();
+    }
+    if (!ReadMem(tmp, 4, &value)) TRAP();
+    nextLoadReg = instr->rt;
+    nextLoadValue = value;
+    NEXT();
+
+CASE(OP_LWL)
+    tmp = registers[instr->rs] + instr->extra;
+
+#ifdef SIM_FIX
+    // The only difference between this code and the BIG ENDIAN code
+    // is that the ReadMem call is guaranteed an aligned access as it
+    // should be (Kane's book hides the fact that all memory access
+    // are done using aligned loads - what the instruction asks for
+    // is a arbitrary) This is the whole purpose of LWL and LWR etc.
+    // Then the switch uses  3 - (tmp & 0x3)  instead of (tmp & 0x3)
+
+    byte = tmp & 0x3;
+    // DEBUG('P', "Addr 0x%X\n",tmp-byte);
+
+    if (!ReadMem(tmp - byte, 4, &value)) TRAP();
+#else
+    // ReadMem assumes all 4 byte requests are aligned on an even
+    // word boundary.  Also, the little endian/big endian swap code
+    // would fail (I think) if the other cases are ever exercised.
+    ASSERT((tmp & 0x3) == 0);
+
+    if (!ReadMem(tmp, 4, &value)) TRAP();
+#endif
+
+    if (registers[LoadReg] == instr->rt)
+        nextLoadValue = registers[LoadValueReg];
+    else
+        nextLoadValue = registers[instr->rt];
+#ifdef SIM_FIX
+    switch (3 - byte)
+#else
+    switch (tmp & 0x3)
+#endif
+    {
+        case 0:
+            nextLoadValue = value;
+            break;
+        case 1:
+            nextLoadValue = (nextLoadValue & 0xff) | (value << 8);
+            break;
+        case 2:
+            nextLoadValue = (nextLoadValue & 0xffff) | (value << 16);
+            break;
+        case 3:
+            nextLoadValue = (nextLoadValue & 0xffffff) | (value << 24);
+            break;
+    }
+    nextLoadReg = instr->rt;
+    NEXT();
+
+CASE(OP_LWR)
+    tmp = registers[instr->rs] + instr->extra;
+
+#ifdef SIM_FIX
+    // The only difference between this code and the BIG ENDIAN code
+    // is that the ReadMem call is guaranteed an aligned access as it
+    // should be (Kane's book hides the fact that all memory access
+    // are done using aligned loads - what the instruction asks
+    // for is a arbitrary) This is the whole purpose of LWL and LWR etc.
+    // Then the switch uses  3 - (tmp & 0x3)  instead of (tmp & 0x3)
+
+    byte = tmp & 0x3;
+    // DEBUG('P', "Addr 0x%X\n",tmp-byte);
+
+    if (!ReadMem(tmp - byte, 4, &value)) TRAP();
+#else
+    // ReadMem assumes all 4 byte requests are aligned on an even
+    // word boundary.  Also, the little endian/big endian swap code
+    // would fail (I think) if the other cases are ever exercised.
+    ASSERT((tmp & 0x3) == 0);
+
+    if (!ReadMem(tmp, 4, &value)) TRAP();
+#endif
+
+    if (registers[LoadReg] == instr->rt)
+        nextLoadValue = registers[LoadValueReg];
+    else
+        nextLoadValue = registers[instr->rt];
+
+#ifdef SIM_FIX
+    switch (3 - byte)
+#else
+    switch (tmp & 0x3)
+#endif
+    {
+        case 0:
+            nextLoadValue =
+                (nextLoadValue & 0xffffff00) | ((value >> 24) & 0xff);
+            break;
+        case 1:
+            nextLoadValue =
+                (nextLoadValue & 0xffff0000) | ((value >> 16) & 0xffff);
+            break;
+        case 2:
+            nextLoadValue = (nextLoadValue & 0xff000000) |
+                            ((value >> 8) & 0xffffff);
+            break;
+        case 3:
+            nextLoadValue = value;
+            break;
+    }
+    nextLoadReg = instr->rt;
+    NEXT();
+
+CASE(OP_MFHI)
+    registers[instr->rd] = registers[HiReg];
+    NEXT();
+
+CASE(OP_MFLO)
+    registers[instr->rd] = registers[LoReg];
+    NEXT();
+
+CASE(OP_MTHI)
+    registers[HiReg] = registers[instr->rs];
+    NEXT();
+
+CASE(OP_MTLO)
+    registers[LoReg] = registers[instr->rs];
+    NEXT();
+
+CASE(OP_MULT)
+    Mult(registers[instr->rs], registers[instr->rt], TRUE,
+         &registers[HiReg], &registers[LoReg]);
+    NEXT();
+
+CASE(OP_MULTU)
+    Mult(registers[instr->rs], registers[instr->rt], FALSE,
+         &registers[HiReg], &registers[LoReg]);
+    NEXT();
+
+CASE(OP_NOR)
+    registers[instr->rd] =
+        ~(registers[instr->rs] | registers[instr->rt]);
+    NEXT();
+
+CASE(OP_OR)
+    registers[instr->rd] = registers[instr->rs] | registers[instr->rt];
+    NEXT();
+
+CASE(OP_ORI)
+    registers[instr->rt] =
+        registers[instr->rs] | (instr->extra & 0xffff);
+    NEXT();
+
+CASE(OP_SB)
+    if (!WriteMem((unsigned)(registers[instr->rs] + instr->extra), 1,
+                  registers[instr->rt]))
+        TRAP();
+    NEXT();
+
+CASE(OP_SH)
+    if (!WriteMem((unsigned)(registers[instr->rs] + instr->extra), 2,
+                  registers[instr->rt]))
+        TRAP();
+    NEXT();
+
+CASE(OP_SLL)
+    registers[instr->rd] = registers[instr->rt] << instr->extra;
+    NEXT();
+
+CASE(OP_SLLV)
+    registers[instr->rd] = registers[instr->rt]
+                           << (registers[instr->rs] & 0x1f);
+    NEXT();
+
+CASE(OP_SLT)
+    if (registers[instr->rs] < registers[instr->rt])
+        registers[instr->rd] = 1;
+    else
+        registers[instr->rd] = 0;
+    NEXT();
+
+CASE(OP_SLTI)
+    if (registers[instr->rs] < instr->extra)
+        registers[instr->rt] = 1;
+    else
+        registers[instr->rt] = 0;
+    NEXT();
+
+CASE(OP_SLTIU)
+    rs = registers[instr->rs];
+    imm = instr->extra;
+    if (rs < imm)
+        registers[instr->rt] = 1;
+    else
+        registers[instr->rt] = 0;
+    NEXT();
+
+CASE(OP_SLTU)
+    rs = registers[instr->rs];
+    rt = registers[instr->rt];
+    if (rs < rt)
+        registers[instr->rd] = 1;
+    else
+        registers[instr->rd] = 0;
+    NEXT();
+
+CASE(OP_SRA)
+    registers[instr->rd] = registers[instr->rt] >> instr->extra;
+    NEXT();
+
+CASE(OP_SRAV)
+    registers[instr->rd] =
+        registers[instr->rt] >> (registers[instr->rs] & 0x1f);
+    NEXT();
+
+CASE(OP_SRL)
+    tmp = registers[instr->rt];
+    tmp >>= instr->extra;
+    registers[instr->rd] = tmp;
+    NEXT();
+
+CASE(OP_SRLV)
+    tmp = registers[instr->rt];
+    tmp >>= (registers[instr->rs] & 0x1f);
+    registers[instr->rd] = tmp;
+    NEXT();
+
+CASE(OP_SUB)
+    diff = registers[instr->rs] - registers[instr->rt];
+    if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
+        ((registers[instr->rs] ^ diff) & SIGN_BIT)) {
+        RaiseException(OverflowException, 0);
+        TRAP();
+    }
+    registers[instr->rd] = diff;
+    NEXT();
+
+CASE(OP_SUBU)
+    registers[instr->rd] = registers[instr->rs] - registers[instr->rt];
+    NEXT();
+
+CASE(OP_SW)
+    if (!WriteMem((unsigned)(registers[instr->rs] + instr->extra), 4,
+                  registers[instr->rt]))
+        TRAP();
+    NEXT();
+
+CASE(OP_SWL)
+    tmp = registers[instr->rs] + instr->extra;
+
+#ifdef SIM_FIX
+    // The only difference between this code and the BIG ENDIAN code
+    // is that the ReadMem call is guaranteed an aligned access as it
+    // should be (Kane's book hides the fact that all memory access
+    // are done using aligned loads - what the instruction asks for
+    // is a arbitrary) This is the whole purpose of LWL and LWR etc.
+
+    byte = tmp & 0x3;
+    // DEBUG('P', "Addr 0x%X\n",tmp-byte);
+    if (!ReadMem(tmp - byte, 4, &value)) TRAP();
+
+        // DEBUG('P', "Value 0x%X\n",value);
+#else
+
+    // The little endian/big endian swap code would
+    // fail (I think) if the other cases are ever exercised.
+    ASSERT((tmp & 0x3) == 0);
+
+    if (!ReadMem((tmp & ~0x3), 4, &value)) TRAP();
+#endif
+
+#ifdef SIM_FIX
+    switch (3 - byte)
+#else
+    switch (tmp & 0x3)
+#endif  // SIM_FIX
+    {
+        case 0:
+            value = registers[instr->rt];
+            break;
+        case 1:
+            value = (value & 0xff000000) |
+                    ((registers[instr->rt] >> 8) & 0xffffff);
+            break;
+        case 2:
+            value = (value & 0xffff0000) |
+                    ((registers[instr->rt] >> 16) & 0xffff);
+            break;
+        case 3:
+            value = (value & 0xffffff00) |
+                    ((registers[instr->rt] >> 24) & 0xff);
+            break;
+    }
+#ifndef SIM_FIX
+    if (!WriteMem((tmp & ~0x3), 4, value)) TRAP();
+#else
+    // DEBUG('P', "Value 0x%X\n",value);
+
+    if (!WriteMem((tmp - byte), 4, value)) TRAP();
+#endif  // SIM_FIX
+    NEXT();
+
+CASE(OP_SWR)
+    tmp = registers[instr->rs] + instr->extra;
+
+#ifndef SIM_FIX
+    // The little endian/big endian swap code would
+    // fail (I think) if the other cases are ever exercised.
+    ASSERT((tmp & 0x3) == 0);
+
+    if (!ReadMem((tmp & ~0x3), 4, &value)) TRAP();
+#else
+    // The only difference between this code and the BIG ENDIAN code
+    // is that the ReadMem call is guaranteed an aligned access as
+    // it should be (Kane's book hides the fact that all memory
+    // access are done using aligned loads - what the instruction
+    // asks for is a arbitrary) This is the whole purpose of LWL
+    // and LWR etc.
+
+    byte = tmp & 0x3;
+    // DEBUG('P', "Addr 0x%X\n",tmp-byte);
+
+    if (!ReadMem(tmp - byte, 4, &value)) TRAP();
+        // DEBUG('P', "Value 0x%X\n",value);
+#endif  // SIM_FIX
+
+#ifndef SIM_FIX
+    switch (tmp & 0x3)
+#else
+    switch (3 - byte)
+#endif  // SIM_FIX
+    {
+        case 0:
+            value = (value & 0xffffff) | (registers[instr->rt] << 24);
+            break;
+        case 1:
+            value = (value & 0xffff) | (registers[instr->rt] << 16);
+            break;
+        case 2:
+            value = (value & 0xff) | (registers[instr->rt] << 8);
+            break;
+        case 3:
+            value = registers[instr->rt];
+            break;
+    }
+
+#ifndef SIM_FIX
+    if (!WriteMem((tmp & ~0x3), 4, value)) TRAP();
+#else
+    // DEBUG('P', "Value 0x%X\n",value);
+
+    if (!WriteMem((tmp - byte), 4, value)) TRAP();
+#endif  // SIM_FIX
+
+    NEXT();
+
+CASE(OP_SYSCALL)
+    RaiseException(SyscallException, 0);
+    TRAP();
+
+CASE(OP_XOR)
+    registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
+    NEXT();
+
+CASE(OP_XORI)
+    registers[instr->rt] =
+        registers[instr->rs] ^ (instr->extra & 0xffff);
+    NEXT();
+
+CASE(OP_RES)
+CASE(OP_UNIMP)
+    RaiseException(IllegalInstrException, 0);
+    TRAP();
@@ -23,26 +23,6 @@
 
 static void Mult(int a, int b, bool signedArith, int *hiPtr, int *loPtr);
 
-// The following class defines an instruction, represented in both
-// 	undecoded binary form
-//      decoded to identify
-//	    operation to do
-//	    registers to act on
-//	    any immediate operand value
-
-class Instruction {
-   public:
-    void Decode();  // decode the binary representation of the instruction
-
-    unsigned int value;  // binary representation of the instruction
-
-    char opCode;      // Type of instruction.  This is NOT the same as the
-                      // opcode field from the instruction: see defs in mips.h
-    char rs, rt, rd;  // Three registers from instruction.
-    int extra;        // Immediate or target or shamt field or offset.
-                      // Immediates are sign-extended.
-};
-
 //----------------------------------------------------------------------
 // Machine::Run
 // 	Simulate the execution of a user-level program on Nachos.
@@ -53,19 +33,59 @@ class Instruction {
 //----------------------------------------------------------------------
 
 void Machine::Run() {
-    Instruction *instr = new Instruction;  // storage for decoded instruction
-
     if (debug->IsEnabled('m')) {
         cout << "Starting program in thread: "
              << kernel->currentThread->getName();
         cout << ", at time: " << kernel->stats->totalTicks << "\n";
     }
     kernel->interrupt->setStatus(UserMode);
+    quietTicks = 0;
+    if (engine != SwitchEngine) RunThreaded();  // never returns
+
     for (;;) {
-        OneInstruction(instr);
-        kernel->interrupt->OneTick();
-        if (singleStep && (runUntilTime <= kernel->stats->totalTicks))
-            Debugger();
+        OneInstruction();
+        AdvanceClock();
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::AdvanceClock
+// 	Called after each user instruction, whether or not it completed:
+//	advance simulated time (which may cause an interrupt or a context
+//	switch), and drop into the debugger if we are single stepping.
+//
+//	When ticks are batched, we ask the interrupt simulation how many
+//	ticks can go by before anything can happen (the "event horizon"),
+//	and just count that many instructions; the ticks are accounted
+//	for in one step (FlushTicks) just before the tick on which
+//	something might happen, or as soon as the kernel is entered.
+//	Since nothing can happen on the skipped ticks, interrupts occur
+//	at exactly the same instruction as without batching.
+//----------------------------------------------------------------------
+
+void Machine::AdvanceClock() {
+    if (quietTicks > 0) {  // nothing can happen on this tick
+        quietTicks--;
+        pendingTicks++;
+        return;
+    }
+    FlushTicks();
+    kernel->interrupt->OneTick();
+    if (singleStep && (runUntilTime <= kernel->stats->totalTicks)) Debugger();
+    if (batchTicks && !singleStep)
+        quietTicks = kernel->interrupt->QuietTicks();
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushTicks
+// 	Account for the user ticks that AdvanceClock has skipped over.
+//	Must be done before the kernel looks at the time.
+//----------------------------------------------------------------------
+
+void Machine::FlushTicks() {
+    if (pendingTicks > 0) {
+        kernel->interrupt->SkipTicks(pendingTicks);
+        pendingTicks = 0;
     }
 }
 
@@ -90,602 +110,500 @@ static int TypeToReg(RegType reg, Instruction *instr) {
 }
 
 //----------------------------------------------------------------------
-// Machine::OneInstruction
-// 	Execute one instruction from a user-level program
+// Machine::FetchInstruction
+// 	Fetch the instruction at the current PC, and return its decoded
+//	form (see DecodedInstruction).
 //
-// 	If there is any kind of exception or interrupt, we invoke the
-//	exception handler, and when it returns, we return to Run(), which
-//	will re-invoke us in a loop.  This allows us to
-//	re-start the instruction execution from the beginning, in
-//	case any of our state has changed.  On a syscall,
-// 	the OS software must increment the PC so execution begins
-// 	at the instruction immediately after the syscall.
+//	The fetch is translated just as ReadMem would, so that the
+//	use bit, page faults and address errors behave exactly as if
+//	the instruction had been read with ReadMem.
 //
-//	This routine is re-entrant, in that it can be called multiple
-//	times concurrently -- one for each thread executing user code.
-//	We get re-entrancy by never caching any data -- we always re-start the
-//	simulation from scratch each time we are called (or after trapping
-//	back to the Nachos kernel on an exception or interrupt), and we always
-//	store all data back to the machine registers and memory before
-//	leaving.  This allows the Nachos kernel to control our behavior
-//	by controlling the contents of memory, the translation table,
-//	and the register set.
+//	Returns NULL if an exception occurred while fetching.
 //----------------------------------------------------------------------
 
-void Machine::OneInstruction(Instruction *instr) {
-#ifdef SIM_FIX
-    int byte;  // described in Kane for LWL,LWR,...
-#endif
+Instruction *Machine::FetchInstruction() {
+    ExceptionType exception;
+    int physicalAddress;
 
-    int raw;
-    int nextLoadReg = 0;
-    int nextLoadValue = 0;  // record delayed load operation, to apply
-                            // in the future
+    physicalAddress = CachedTranslate(registers[PCReg], 4, FALSE);
+    if (physicalAddress >= 0) return DecodedInstruction(physicalAddress);
 
-    // Fetch instruction
-    if (!ReadMem(registers[PCReg], 4, &raw)) return;  // exception occurred
-    instr->value = raw;
-    instr->Decode();
+    DEBUG(dbgAddr, "Fetching VA " << registers[PCReg]);
 
-    if (debug->IsEnabled('m')) {
-        struct OpString *str = &opStrings[instr->opCode];
-        char buf[80];
-
-        ASSERT(instr->opCode <= MaxOpcode);
-        cout << "At PC = " << registers[PCReg];
-        sprintf(buf, str->format, TypeToReg(str->args[0], instr),
-                TypeToReg(str->args[1], instr), TypeToReg(str->args[2], instr));
-        cout << "\t" << buf << "\n";
+    exception = Translate(registers[PCReg], &physicalAddress, 4, FALSE);
+    if (exception != NoException) {
+        RaiseException(exception, registers[PCReg]);
+        return NULL;
     }
+    CacheTranslation(registers[PCReg], physicalAddress, FALSE);
+    return DecodedInstruction(physicalAddress);
+}
 
-    // Compute next pc, but don't install in case there's an error or branch.
-    int pcAfter = registers[NextPCReg] + 4;
-    int sum, diff, tmp, value;
-    unsigned int rs, rt, imm;
-
-    // Execute the instruction (cf. Kane's book)
-    switch (instr->opCode) {
-        case OP_ADD:
-            sum = registers[instr->rs] + registers[instr->rt];
-            if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
-                ((registers[instr->rs] ^ sum) & SIGN_BIT)) {
-                RaiseException(OverflowException, 0);
-                return;
-            }
-            registers[instr->rd] = sum;
-            break;
-
-        case OP_ADDI:
-            sum = registers[instr->rs] + instr->extra;
-            if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
-                ((instr->extra ^ sum) & SIGN_BIT)) {
-                RaiseException(OverflowException, 0);
-                return;
-            }
-            registers[instr->rt] = sum;
-            break;
-
-        case OP_ADDIU:
-            registers[instr->rt] = registers[instr->rs] + instr->extra;
-            break;
+//----------------------------------------------------------------------
+// Machine::DecodedInstruction
+// 	Return the decoded form of the instruction at a physical address.
+//	Instructions are decoded the first time they are executed from a
+//	given physical address; after that, the decoded copy is kept in
+//	"decodeCache" until the page frame is written to or reloaded (see
+//	InvalidateDecodedPage).
+//
+//	"physAddr" -- the (word aligned) physical address
+//----------------------------------------------------------------------
 
-        case OP_ADDU:
-            registers[instr->rd] = registers[instr->rs] + registers[instr->rt];
-            break;
+Instruction *Machine::DecodedInstruction(int physAddr) {
+    Instruction *instr = &decodeCache[physAddr / 4];
 
-        case OP_AND:
-            registers[instr->rd] = registers[instr->rs] & registers[instr->rt];
-            break;
+    if (instr->opCode == 0) {  // not yet decoded
+        instr->value = WordToHost(*(unsigned int *)&mainMemory[physAddr]);
+        instr->Decode();
+        instr->handler =
+            (dispatchTable != NULL) ? dispatchTable[(int)instr->opCode] : NULL;
+        instr->blockLength = 0;
+        decodedPage[physAddr / PageSize] = TRUE;
+    }
+    return instr;
+}
 
-        case OP_ANDI:
-            registers[instr->rt] =
-                registers[instr->rs] & (instr->extra & 0xffff);
-            break;
+//----------------------------------------------------------------------
+// EndsBlock
+// 	Does this instruction end a basic block?  Branches and jumps do
+//	(after their delay slot), and so does anything that always traps
+//	to the kernel.
+//
+//	"delaySlot" -- set to TRUE if the instruction has a delay slot
+//----------------------------------------------------------------------
 
+static bool EndsBlock(int opCode, bool *delaySlot) {
+    switch (opCode) {
         case OP_BEQ:
-            if (registers[instr->rs] == registers[instr->rt])
-                pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-            break;
-
-        case OP_BGEZAL:
-            registers[R31] = registers[NextPCReg] + 4;
         case OP_BGEZ:
-            if (!(registers[instr->rs] & SIGN_BIT))
-                pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-            break;
-
+        case OP_BGEZAL:
         case OP_BGTZ:
-            if (registers[instr->rs] > 0)
-                pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-            break;
-
         case OP_BLEZ:
-            if (registers[instr->rs] <= 0)
-                pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-            break;
-
-        case OP_BLTZAL:
-            registers[R31] = registers[NextPCReg] + 4;
         case OP_BLTZ:
-            if (registers[instr->rs] & SIGN_BIT)
-                pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-            break;
-
+        case OP_BLTZAL:
         case OP_BNE:
-            if (registers[instr->rs] != registers[instr->rt])
-                pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-            break;
-
-        case OP_DIV:
-            if (registers[instr->rt] == 0) {
-                registers[LoReg] = 0;
-                registers[HiReg] = 0;
-                // cout << "Got divide by zero exception\n";
-                RaiseException(IllegalInstrException, 1);
-                // while catching use type 8
-                return;
-            } else {
-                registers[LoReg] = registers[instr->rs] / registers[instr->rt];
-                registers[HiReg] = registers[instr->rs] % registers[instr->rt];
-            }
-            break;
-
-        case OP_DIVU:
-            rs = (unsigned int)registers[instr->rs];
-            rt = (unsigned int)registers[instr->rt];
-            if (rt == 0) {
-                registers[LoReg] = 0;
-                registers[HiReg] = 0;
-                // cout << "Got divide by zero exception\n";
-                RaiseException(IllegalInstrException, 1);
-                // while catching use type 8
-                return;
-            } else {
-                tmp = rs / rt;
-                registers[LoReg] = (int)tmp;
-                tmp = rs % rt;
-                registers[HiReg] = (int)tmp;
-            }
-            break;
-
-        case OP_JAL:
-            registers[R31] = registers[NextPCReg] + 4;
         case OP_J:
-            pcAfter = (pcAfter & 0xf0000000) | IndexToAddr(instr->extra);
-            break;
-
+        case OP_JAL:
         case OP_JALR:
-            registers[instr->rd] = registers[NextPCReg] + 4;
         case OP_JR:
-            pcAfter = registers[instr->rs];
-            break;
+            *delaySlot = TRUE;
+            return TRUE;
 
-        case OP_LB:
-        case OP_LBU:
-            tmp = registers[instr->rs] + instr->extra;
-            if (!ReadMem(tmp, 1, &value)) return;
-
-            if ((value & 0x80) && (instr->opCode == OP_LB))
-                value |= 0xffffff00;
-            else
-                value &= 0xff;
-            nextLoadReg = instr->rt;
-            nextLoadValue = value;
-            break;
+        case OP_SYSCALL:
+        case OP_RES:
+        case OP_UNIMP:
+            *delaySlot = FALSE;
+            return TRUE;
 
-        case OP_LH:
-        case OP_LHU:
-            tmp = registers[instr->rs] + instr->extra;
-            if (tmp & 0x1) {
-                RaiseException(AddressErrorException, tmp);
-                return;
-            }
-            if (!ReadMem(tmp, 2, &value)) return;
-
-            if ((value & 0x8000) && (instr->opCode == OP_LH))
-                value |= 0xffff0000;
-            else
-                value &= 0xffff;
-            nextLoadReg = instr->rt;
-            nextLoadValue = value;
-            break;
+        default:
+            return FALSE;
+    }
+}
 
-        case OP_LUI:
-            DEBUG(dbgMach,
-                  "Executing: LUI r" << instr->rt << ", " << instr->extra);
-            registers[instr->rt] = instr->extra << 16;
-            break;
+//----------------------------------------------------------------------
+// Machine::TranslateBlock
+// 	Translate the basic block starting at "entry": decode its
+//	instructions, and record in each of them how many instructions are
+//	left before the end of the block.  A block ends after the delay
+//	slot of its first branch or jump, or at the end of the page,
+//	whichever comes first.
+//
+//	Since a block never crosses a page, one translation of the PC
+//	covers every instruction in it; and since it lives in the decoded
+//	instructions for the page, it goes away whenever they do.
+//
+//	"entry" -- the first instruction of the block (already decoded)
+//----------------------------------------------------------------------
 
-        case OP_LW:
-            tmp = registers[instr->rs] + instr->extra;
-            if (tmp & 0x3) {
-                RaiseException(AddressErrorException, tmp);
-                return;
+void Machine::TranslateBlock(Instruction *entry) {
+    int first = entry - decodeCache;  // word index into physical memory
+    int pageEnd = (first / InstrsPerPage + 1) * InstrsPerPage;
+    int last;  // last instruction in the block
+    bool delaySlot = FALSE;
+
+    for (last = first;; last++) {
+        if (EndsBlock(DecodedInstruction(last * 4)->opCode, &delaySlot)) {
+            if (delaySlot && last + 1 < pageEnd) {
+                last++;
+                DecodedInstruction(last * 4);
             }
-            if (!ReadMem(tmp, 4, &value)) return;
-            nextLoadReg = instr->rt;
-            nextLoadValue = value;
             break;
+        }
+        if (last == pageEnd - 1) break;
+    }
+    for (int i = first; i <= last; i++)
+        decodeCache[i].blockLength = last - i + 1;
+    DEBUG(dbgMach,
+          "Translated block of " << last - first + 1 << " at " << first * 4);
+}
 
-        case OP_LWL:
-            tmp = registers[instr->rs] + instr->extra;
+//----------------------------------------------------------------------
+// Machine::TraceInstruction
+// 	Print the instruction about to be executed, for debugging.
+//----------------------------------------------------------------------
 
-#ifdef SIM_FIX
-            // The only difference between this code and the BIG ENDIAN code
-            // is that the ReadMem call is guaranteed an aligned access as it
-            // should be (Kane's book hides the fact that all memory access
-            // are done using aligned loads - what the instruction asks for
-            // is a arbitrary) This is the whole purpose of LWL and LWR etc.
-            // Then the switch uses  3 - (tmp & 0x3)  instead of (tmp & 0x3)
-
-            byte = tmp & 0x3;
-            // DEBUG('P', "Addr 0x%X\n",tmp-byte);
-
-            if (!ReadMem(tmp - byte, 4, &value)) return;
-#else
-            // ReadMem assumes all 4 byte requests are aligned on an even
-            // word boundary.  Also, the little endian/big endian swap code
-            // would fail (I think) if the other cases are ever exercised.
-            ASSERT((tmp & 0x3) == 0);
-
-            if (!ReadMem(tmp, 4, &value)) return;
-#endif
+void Machine::TraceInstruction(Instruction *instr) {
+    struct OpString *str = &opStrings[instr->opCode];
+    char buf[80];
 
-            if (registers[LoadReg] == instr->rt)
-                nextLoadValue = registers[LoadValueReg];
-            else
-                nextLoadValue = registers[instr->rt];
-#ifdef SIM_FIX
-            switch (3 - byte)
-#else
-            switch (tmp & 0x3)
-#endif
-            {
-                case 0:
-                    nextLoadValue = value;
-                    break;
-                case 1:
-                    nextLoadValue = (nextLoadValue & 0xff) | (value << 8);
-                    break;
-                case 2:
-                    nextLoadValue = (nextLoadValue & 0xffff) | (value << 16);
-                    break;
-                case 3:
-                    nextLoadValue = (nextLoadValue & 0xffffff) | (value << 24);
-                    break;
-            }
-            nextLoadReg = instr->rt;
-            break;
+    ASSERT(instr->opCode <= MaxOpcode);
+    cout << "At PC = " << registers[PCReg];
+    sprintf(buf, str->format, TypeToReg(str->args[0], instr),
+            TypeToReg(str->args[1], instr), TypeToReg(str->args[2], instr));
+    cout << "\t" << buf << "\n";
+}
 
-        case OP_LWR:
-            tmp = registers[instr->rs] + instr->extra;
+//----------------------------------------------------------------------
+// Machine::InvalidateDecodedPage
+// 	Throw away the predecoded instructions for a page frame, because
+//	its contents are about to change.
+//
+//	"physPage" -- the physical page number
+//----------------------------------------------------------------------
 
-#ifdef SIM_FIX
-            // The only difference between this code and the BIG ENDIAN code
-            // is that the ReadMem call is guaranteed an aligned access as it
-            // should be (Kane's book hides the fact that all memory access
-            // are done using aligned loads - what the instruction asks
-            // for is a arbitrary) This is the whole purpose of LWL and LWR etc.
-            // Then the switch uses  3 - (tmp & 0x3)  instead of (tmp & 0x3)
-
-            byte = tmp & 0x3;
-            // DEBUG('P', "Addr 0x%X\n",tmp-byte);
-
-            if (!ReadMem(tmp - byte, 4, &value)) return;
-#else
-            // ReadMem assumes all 4 byte requests are aligned on an even
-            // word boundary.  Also, the little endian/big endian swap code
-            // would fail (I think) if the other cases are ever exercised.
-            ASSERT((tmp & 0x3) == 0);
-
-            if (!ReadMem(tmp, 4, &value)) return;
-#endif
+void Machine::InvalidateDecodedPage(int physPage) {
+    ASSERT(physPage >= 0 && physPage < NumPhysPages);
+    if (!decodedPage[physPage]) return;
 
-            if (registers[LoadReg] == instr->rt)
-                nextLoadValue = registers[LoadValueReg];
-            else
-                nextLoadValue = registers[instr->rt];
+    Instruction *instr = &decodeCache[physPage * InstrsPerPage];
+    for (int i = 0; i < InstrsPerPage; i++) instr[i].opCode = 0;
+    decodedPage[physPage] = FALSE;
+    translationEpoch++;
+}
+
+//----------------------------------------------------------------------
+// Machine::OneInstruction
+// 	Execute one instruction from a user-level program
+//
+// 	If there is any kind of exception or interrupt, we invoke the
+//	exception handler, and when it returns, we return to Run(), which
+//	will re-invoke us in a loop.  This allows us to
+//	re-start the instruction execution from the beginning, in
+//	case any of our state has changed.  On a syscall,
+// 	the OS software must increment the PC so execution begins
+// 	at the instruction immediately after the syscall.
+//
+//	This routine is re-entrant, in that it can be called multiple
+//	times concurrently -- one for each thread executing user code.
+//	We get re-entrancy by never caching any data -- we always re-start the
+//	simulation from scratch each time we are called (or after trapping
+//	back to the Nachos kernel on an exception or interrupt), and we always
+//	store all data back to the machine registers and memory before
+//	leaving.  This allows the Nachos kernel to control our behavior
+//	by controlling the contents of memory, the translation table,
+//	and the register set.
+//----------------------------------------------------------------------
 
+void Machine::OneInstruction() {
 #ifdef SIM_FIX
-            switch (3 - byte)
-#else
-            switch (tmp & 0x3)
+    int byte;  // described in Kane for LWL,LWR,...
 #endif
-            {
-                case 0:
-                    nextLoadValue =
-                        (nextLoadValue & 0xffffff00) | ((value >> 24) & 0xff);
-                    break;
-                case 1:
-                    nextLoadValue =
-                        (nextLoadValue & 0xffff0000) | ((value >> 16) & 0xffff);
-                    break;
-                case 2:
-                    nextLoadValue = (nextLoadValue & 0xff000000) |
-                                    ((value >> 8) & 0xffffff);
-                    break;
-                case 3:
-                    nextLoadValue = value;
-                    break;
-            }
-            nextLoadReg = instr->rt;
-            break;
-
-        case OP_MFHI:
-            registers[instr->rd] = registers[HiReg];
-            break;
-
-        case OP_MFLO:
-            registers[instr->rd] = registers[LoReg];
-            break;
-
-        case OP_MTHI:
-            registers[HiReg] = registers[instr->rs];
-            break;
-
-        case OP_MTLO:
-            registers[LoReg] = registers[instr->rs];
-            break;
-
-        case OP_MULT:
-            Mult(registers[instr->rs], registers[instr->rt], TRUE,
-                 &registers[HiReg], &registers[LoReg]);
-            break;
-
-        case OP_MULTU:
-            Mult(registers[instr->rs], registers[instr->rt], FALSE,
-                 &registers[HiReg], &registers[LoReg]);
-            break;
-
-        case OP_NOR:
-            registers[instr->rd] =
-                ~(registers[instr->rs] | registers[instr->rt]);
-            break;
-
-        case OP_OR:
-            registers[instr->rd] = registers[instr->rs] | registers[instr->rt];
-            break;
 
-        case OP_ORI:
-            registers[instr->rt] =
-                registers[instr->rs] | (instr->extra & 0xffff);
-            break;
-
-        case OP_SB:
-            if (!WriteMem((unsigned)(registers[instr->rs] + instr->extra), 1,
-                          registers[instr->rt]))
-                return;
-            break;
-
-        case OP_SH:
-            if (!WriteMem((unsigned)(registers[instr->rs] + instr->extra), 2,
-                          registers[instr->rt]))
-                return;
-            break;
-
-        case OP_SLL:
-            registers[instr->rd] = registers[instr->rt] << instr->extra;
-            break;
-
-        case OP_SLLV:
-            registers[instr->rd] = registers[instr->rt]
-                                   << (registers[instr->rs] & 0x1f);
-            break;
-
-        case OP_SLT:
-            if (registers[instr->rs] < registers[instr->rt])
-                registers[instr->rd] = 1;
-            else
-                registers[instr->rd] = 0;
-            break;
-
-        case OP_SLTI:
-            if (registers[instr->rs] < instr->extra)
-                registers[instr->rt] = 1;
-            else
-                registers[instr->rt] = 0;
-            break;
-
-        case OP_SLTIU:
-            rs = registers[instr->rs];
-            imm = instr->extra;
-            if (rs < imm)
-                registers[instr->rt] = 1;
-            else
-                registers[instr->rt] = 0;
-            break;
+    Instruction *instr;
+    int nextLoadReg = 0;
+    int nextLoadValue = 0;  // record delayed load operation, to apply
+                            // in the future
 
-        case OP_SLTU:
-            rs = registers[instr->rs];
-            rt = registers[instr->rt];
-            if (rs < rt)
-                registers[instr->rd] = 1;
-            else
-                registers[instr->rd] = 0;
-            break;
+    // Fetch instruction
+    instr = FetchInstruction();
+    if (instr == NULL) return;  // exception occurred
 
-        case OP_SRA:
-            registers[instr->rd] = registers[instr->rt] >> instr->extra;
-            break;
+    if (debug->IsEnabled('m')) TraceInstruction(instr);
 
-        case OP_SRAV:
-            registers[instr->rd] =
-                registers[instr->rt] >> (registers[instr->rs] & 0x1f);
-            break;
+    // Compute next pc, but don't install in case there's an error or branch.
+    int pcAfter = registers[NextPCReg] + 4;
+    int sum, diff, tmp, value;
+    unsigned int rs, rt, imm;
 
-        case OP_SRL:
-            tmp = registers[instr->rt];
-            tmp >>= instr->extra;
-            registers[instr->rd] = tmp;
-            break;
+    // Execute the instruction (see mipsops.h)
+    switch (instr->opCode) {
+#define CASE(op) case op:
+#define NEXT() break
+#define TRAP() return
+#include "mipsops.h"
+#undef CASE
+#undef NEXT
+#undef TRAP
 
-        case OP_SRLV:
-            tmp = registers[instr->rt];
-            tmp >>= (registers[instr->rs] & 0x1f);
-            registers[instr->rd] = tmp;
-            break;
+        default:
+            ASSERT(FALSE);
+    }
 
-        case OP_SUB:
-            diff = registers[instr->rs] - registers[instr->rt];
-            if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
-                ((registers[instr->rs] ^ diff) & SIGN_BIT)) {
-                RaiseException(OverflowException, 0);
-                return;
-            }
-            registers[instr->rd] = diff;
-            break;
+    // Now we have successfully executed the instruction.
 
-        case OP_SUBU:
-            registers[instr->rd] = registers[instr->rs] - registers[instr->rt];
-            break;
+    // Do any delayed load operation
+    DelayedLoad(nextLoadReg, nextLoadValue);
 
-        case OP_SW:
-            if (!WriteMem((unsigned)(registers[instr->rs] + instr->extra), 4,
-                          registers[instr->rt]))
-                return;
-            break;
+    // Advance program counters.
+    registers[PrevPCReg] = registers[PCReg];  // for debugging, in case we
+                                              // are jumping into lala-land
+    registers[PCReg] = registers[NextPCReg];
+    registers[NextPCReg] = pcAfter;
+}
 
-        case OP_SWL:
-            tmp = registers[instr->rs] + instr->extra;
+//----------------------------------------------------------------------
+// Machine::RunThreaded
+// 	Simulate the execution of a user-level program, using
+//	direct-threaded dispatch instead of the switch statement in
+//	OneInstruction.
+//
+//	Every decoded instruction records the address of the code that
+//	executes it (its "handler"); this is filled in once, when the
+//	instruction is decoded.  Each handler finishes by fetching the
+//	next instruction and jumping straight to that instruction's
+//	handler, so the host sees one indirect jump per handler, which it
+//	predicts much better than the single jump through the switch.
+//	The handlers use the GNU "labels as values" extension.
+//
+//	With the BlockEngine, the program is run a basic block at a time
+//	(see TranslateBlock): the PC is translated once, on entry to the
+//	block, and the following instructions are taken straight from the
+//	decoded copy of the page.  Every instruction still updates the PC
+//	registers and lets time pass, so exceptions, system calls and
+//	interrupts happen at exactly the same instruction as with the other
+//	engines.  If the kernel runs in the middle of a block (an exception,
+//	a context switch, a page being written), the rest of the block is
+//	fetched normally.
+//
+//	The handlers are the cases of OneInstruction, compiled a second
+//	time: both engines include the code for each instruction from
+//	mipsops.h.  With the CheckedEngine, every instruction that
+//	completes is run a second time through OneInstruction, from the
+//	same starting state, and the resulting registers, and any memory
+//	stored to, must match (see CrossCheck).
+//
+//	Like Run, this never returns, and is re-entrant.
+//----------------------------------------------------------------------
 
+void Machine::RunThreaded() {
+    static void *handlers[MaxOpcode + 1];
 #ifdef SIM_FIX
-            // The only difference between this code and the BIG ENDIAN code
-            // is that the ReadMem call is guaranteed an aligned access as it
-            // should be (Kane's book hides the fact that all memory access
-            // are done using aligned loads - what the instruction asks for
-            // is a arbitrary) This is the whole purpose of LWL and LWR etc.
-
-            byte = tmp & 0x3;
-            // DEBUG('P', "Addr 0x%X\n",tmp-byte);
-            if (!ReadMem(tmp - byte, 4, &value)) return;
-
-                // DEBUG('P', "Value 0x%X\n",value);
-#else
-
-            // The little endian/big endian swap code would
-            // fail (I think) if the other cases are ever exercised.
-            ASSERT((tmp & 0x3) == 0);
-
-            if (!ReadMem((tmp & ~0x3), 4, &value)) return;
+    int byte;  // described in Kane for LWL,LWR,...
 #endif
+    Instruction *instr;
+    int nextLoadReg;
+    int nextLoadValue;  // record delayed load operation, to apply
+                        // in the future
+    int pcAfter;
+    int blockLeft;  // instructions left to run in this basic block
+    int epoch;      // translationEpoch when the block was entered
+    int sum, diff, tmp, value;
+    unsigned int rs, rt, imm;
 
-#ifdef SIM_FIX
-            switch (3 - byte)
-#else
-            switch (tmp & 0x3)
-#endif  // SIM_FIX
-            {
-                case 0:
-                    value = registers[instr->rt];
-                    break;
-                case 1:
-                    value = (value & 0xff000000) |
-                            ((registers[instr->rt] >> 8) & 0xffffff);
-                    break;
-                case 2:
-                    value = (value & 0xffff0000) |
-                            ((registers[instr->rt] >> 16) & 0xffff);
-                    break;
-                case 3:
-                    value = (value & 0xffffff00) |
-                            ((registers[instr->rt] >> 24) & 0xff);
-                    break;
-            }
-#ifndef SIM_FIX
-            if (!WriteMem((tmp & ~0x3), 4, value)) return;
-#else
-            // DEBUG('P', "Value 0x%X\n",value);
-
-            if (!WriteMem((tmp - byte), 4, value)) return;
-#endif  // SIM_FIX
-            break;
-
-        case OP_SWR:
-            tmp = registers[instr->rs] + instr->extra;
-
-#ifndef SIM_FIX
-            // The little endian/big endian swap code would
-            // fail (I think) if the other cases are ever exercised.
-            ASSERT((tmp & 0x3) == 0);
-
-            if (!ReadMem((tmp & ~0x3), 4, &value)) return;
-#else
-            // The only difference between this code and the BIG ENDIAN code
-            // is that the ReadMem call is guaranteed an aligned access as
-            // it should be (Kane's book hides the fact that all memory
-            // access are done using aligned loads - what the instruction
-            // asks for is a arbitrary) This is the whole purpose of LWL
-            // and LWR etc.
-
-            byte = tmp & 0x3;
-            // DEBUG('P', "Addr 0x%X\n",tmp-byte);
-
-            if (!ReadMem(tmp - byte, 4, &value)) return;
-                // DEBUG('P', "Value 0x%X\n",value);
-#endif  // SIM_FIX
-
-#ifndef SIM_FIX
-            switch (tmp & 0x3)
-#else
-            switch (3 - byte)
-#endif  // SIM_FIX
-            {
-                case 0:
-                    value = (value & 0xffffff) | (registers[instr->rt] << 24);
-                    break;
-                case 1:
-                    value = (value & 0xffff) | (registers[instr->rt] << 16);
-                    break;
-                case 2:
-                    value = (value & 0xff) | (registers[instr->rt] << 8);
-                    break;
-                case 3:
-                    value = registers[instr->rt];
-                    break;
-            }
-
-#ifndef SIM_FIX
-            if (!WriteMem((tmp & ~0x3), 4, value)) return;
-#else
-            // DEBUG('P', "Value 0x%X\n",value);
-
-            if (!WriteMem((tmp - byte), 4, value)) return;
-#endif  // SIM_FIX
-
-            break;
-
-        case OP_SYSCALL:
-            RaiseException(SyscallException, 0);
-            return;
+    if (dispatchTable == NULL) {
+        for (int i = 0; i <= MaxOpcode; i++) handlers[i] = &&op_bad;
+        handlers[OP_ADD] = &&do_OP_ADD;
+        handlers[OP_ADDI] = &&do_OP_ADDI;
+        handlers[OP_ADDIU] = &&do_OP_ADDIU;
+        handlers[OP_ADDU] = &&do_OP_ADDU;
+        handlers[OP_AND] = &&do_OP_AND;
+        handlers[OP_ANDI] = &&do_OP_ANDI;
+        handlers[OP_BEQ] = &&do_OP_BEQ;
+        handlers[OP_BGEZAL] = &&do_OP_BGEZAL;
+        handlers[OP_BGEZ] = &&do_OP_BGEZ;
+        handlers[OP_BGTZ] = &&do_OP_BGTZ;
+        handlers[OP_BLEZ] = &&do_OP_BLEZ;
+        handlers[OP_BLTZAL] = &&do_OP_BLTZAL;
+        handlers[OP_BLTZ] = &&do_OP_BLTZ;
+        handlers[OP_BNE] = &&do_OP_BNE;
+        handlers[OP_DIV] = &&do_OP_DIV;
+        handlers[OP_DIVU] = &&do_OP_DIVU;
+        handlers[OP_JAL] = &&do_OP_JAL;
+        handlers[OP_J] = &&do_OP_J;
+        handlers[OP_JALR] = &&do_OP_JALR;
+        handlers[OP_JR] = &&do_OP_JR;
+        handlers[OP_LB] = &&do_OP_LB;
+        handlers[OP_LBU] = &&do_OP_LBU;
+        handlers[OP_LH] = &&do_OP_LH;
+        handlers[OP_LHU] = &&do_OP_LHU;
+        handlers[OP_LUI] = &&do_OP_LUI;
+        handlers[OP_LW] = &&do_OP_LW;
+        handlers[OP_LWL] = &&do_OP_LWL;
+        handlers[OP_LWR] = &&do_OP_LWR;
+        handlers[OP_MFHI] = &&do_OP_MFHI;
+        handlers[OP_MFLO] = &&do_OP_MFLO;
+        handlers[OP_MTHI] = &&do_OP_MTHI;
+        handlers[OP_MTLO] = &&do_OP_MTLO;
+        handlers[OP_MULT] = &&do_OP_MULT;
+        handlers[OP_MULTU] = &&do_OP_MULTU;
+        handlers[OP_NOR] = &&do_OP_NOR;
+        handlers[OP_OR] = &&do_OP_OR;
+        handlers[OP_ORI] = &&do_OP_ORI;
+        handlers[OP_SB] = &&do_OP_SB;
+        handlers[OP_SH] = &&do_OP_SH;
+        handlers[OP_SLL] = &&do_OP_SLL;
+        handlers[OP_SLLV] = &&do_OP_SLLV;
+        handlers[OP_SLT] = &&do_OP_SLT;
+        handlers[OP_SLTI] = &&do_OP_SLTI;
+        handlers[OP_SLTIU] = &&do_OP_SLTIU;
+        handlers[OP_SLTU] = &&do_OP_SLTU;
+        handlers[OP_SRA] = &&do_OP_SRA;
+        handlers[OP_SRAV] = &&do_OP_SRAV;
+        handlers[OP_SRL] = &&do_OP_SRL;
+        handlers[OP_SRLV] = &&do_OP_SRLV;
+        handlers[OP_SUB] = &&do_OP_SUB;
+        handlers[OP_SUBU] = &&do_OP_SUBU;
+        handlers[OP_SW] = &&do_OP_SW;
+        handlers[OP_SWL] = &&do_OP_SWL;
+        handlers[OP_SWR] = &&do_OP_SWR;
+        handlers[OP_SYSCALL] = &&do_OP_SYSCALL;
+        handlers[OP_XOR] = &&do_OP_XOR;
+        handlers[OP_XORI] = &&do_OP_XORI;
+        handlers[OP_RES] = &&do_OP_RES;
+        handlers[OP_UNIMP] = &&do_OP_UNIMP;
+        dispatchTable = handlers;
+    }
 
-        case OP_XOR:
-            registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
-            break;
+// Set up for executing "instr", and jump to its handler.
+#define START()                             \
+    do {                                    \
+        nextLoadReg = 0;                    \
+        nextLoadValue = 0;                  \
+        pcAfter = registers[NextPCReg] + 4; \
+        goto *instr->handler;               \
+    } while (0)
+
+// Fetch the instruction at the PC (re-trying until the fetch doesn't
+// trap), find out how much of its basic block we can run without
+// fetching again, and start it.
+#define DISPATCH()                                              \
+    do {                                                        \
+        while ((instr = ThreadedFetch()) == NULL) {             \
+        }                                                       \
+        blockLeft = 1;                                          \
+        if (engine == BlockEngine) {                            \
+            if (instr->blockLength == 0) TranslateBlock(instr); \
+            blockLeft = instr->blockLength;                     \
+        }                                                       \
+        epoch = translationEpoch;                               \
+        START();                                                \
+    } while (0)
+
+// The instruction completed: commit it, then go on to the next one.
+// Within a basic block, that is simply the next decoded instruction,
+// unless the kernel has run and may have changed the translation.
+#define NEXT()                                                    \
+    do {                                                          \
+        CompleteInstruction(nextLoadReg, nextLoadValue, pcAfter); \
+        if (--blockLeft > 0 && epoch == translationEpoch) {       \
+            instr++;                                              \
+            if (debug->IsEnabled('m')) TraceInstruction(instr);   \
+            START();                                              \
+        }                                                         \
+        DISPATCH();                                               \
+    } while (0)
+
+// The instruction trapped to the kernel: it has already done whatever
+// was needed with the PC, so just let time pass.
+#define TRAP()          \
+    do {                \
+        AdvanceClock(); \
+        DISPATCH();     \
+    } while (0)
+
+    DISPATCH();
+
+#define CASE(op) do_##op:  // the handler for opcode "op"
+#include "mipsops.h"
+#undef CASE
+
+op_bad:
+    ASSERTNOTREACHED();
+
+#undef START
+#undef DISPATCH
+#undef NEXT
+#undef TRAP
+}
 
-        case OP_XORI:
-            registers[instr->rt] =
-                registers[instr->rs] ^ (instr->extra & 0xffff);
-            break;
+//----------------------------------------------------------------------
+// Machine::ThreadedFetch
+// 	Fetch the next instruction for RunThreaded.  Returns NULL if the
+//	fetch trapped to the kernel, after letting time pass, so that the
+//	caller can simply try again.
+//----------------------------------------------------------------------
 
-        case OP_RES:
-        case OP_UNIMP:
-            RaiseException(IllegalInstrException, 0);
-            return;
+Instruction *Machine::ThreadedFetch() {
+    Instruction *instr = FetchInstruction();
 
-        default:
-            ASSERT(FALSE);
+    if (instr == NULL) {  // exception occurred
+        AdvanceClock();
+        return NULL;
+    }
+    if (debug->IsEnabled('m')) TraceInstruction(instr);
+    if (engine == CheckedEngine) {
+        memcpy(checkRegisters, registers, sizeof(registers));
+        checkStore = -1;
     }
+    return instr;
+}
 
-    // Now we have successfully executed the instruction.
+//----------------------------------------------------------------------
+// Machine::CompleteInstruction
+// 	An instruction run by RunThreaded completed without an exception:
+//	do any delayed load and advance the program counters, just as at
+//	the end of OneInstruction, then let time pass.
+//----------------------------------------------------------------------
 
-    // Do any delayed load operation
+void Machine::CompleteInstruction(int nextLoadReg, int nextLoadValue,
+                                  int pcAfter) {
     DelayedLoad(nextLoadReg, nextLoadValue);
 
-    // Advance program counters.
-    registers[PrevPCReg] = registers[PCReg];  // for debugging, in case we
-                                              // are jumping into lala-land
+    registers[PrevPCReg] = registers[PCReg];
     registers[PCReg] = registers[NextPCReg];
     registers[NextPCReg] = pcAfter;
+
+    if (engine == CheckedEngine) CrossCheck();
+    AdvanceClock();
+}
+
+//----------------------------------------------------------------------
+// Machine::CrossCheck
+// 	Check the instruction just completed by RunThreaded against the
+//	switch engine: restore the registers saved when the instruction
+//	was fetched, and the memory word it stored to (see WriteMem),
+//	execute it again with OneInstruction, and compare the registers,
+//	and where and what each engine stored.
+//
+//	Only instructions that completed normally are checked, so there
+//	is no second trap to the kernel.  Loads need no more than the
+//	register check, since reading memory doesn't change it.
+//----------------------------------------------------------------------
+
+void Machine::CrossCheck() {
+    int threaded[NumTotalRegs];
+    int threadedStore = checkStore;
+    unsigned int threadedWord = 0, switchWord = 0;
+
+    memcpy(threaded, registers, sizeof(registers));
+    memcpy(registers, checkRegisters, sizeof(registers));
+    if (threadedStore >= 0) {
+        threadedWord = *(unsigned int *)&mainMemory[threadedStore];
+        *(unsigned int *)&mainMemory[threadedStore] = checkStoreWord;
+    }
+    checkStore = -1;
+    OneInstruction();
+
+    for (int i = 0; i < NumTotalRegs; i++) {
+        if (registers[i] != threaded[i]) {
+            cout << "Threaded engine mismatch at PC = "
+                 << checkRegisters[PCReg] << ": register " << i
+                 << " is " << threaded[i] << ", should be " << registers[i]
+                 << "\n";
+            ASSERTNOTREACHED();
+        }
+    }
+    if (checkStore >= 0) {
+        switchWord = *(unsigned int *)&mainMemory[checkStore];
+    }
+    if (checkStore != threadedStore || switchWord != threadedWord) {
+        cout << "Threaded engine mismatch at PC = " << checkRegisters[PCReg]
+             << ": stored " << threadedWord << " at physical address "
+             << threadedStore << ", should be " << switchWord << " at "
+             << checkStore << "\n";
+        ASSERTNOTREACHED();
+    }
 }
 
 //----------------------------------------------------------------------
@@ -10,6 +10,7 @@
 #include "copyright.h"
 #include "debug.h"
 #include "stats.h"
+#include "slab.h"
 
 //----------------------------------------------------------------------
 // Statistics::Statistics
@@ -19,8 +20,56 @@
 Statistics::Statistics() {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
+    numCacheHits = numCacheMisses = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
-    numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numPageFaults = numPageEvictions = numPagesPrefetched = 0;
+    numPacketsSent = numPacketsRecvd = 0;
+    processes = new List<ProcessStats *>;
+}
+
+//----------------------------------------------------------------------
+// Statistics::~Statistics
+// 	De-allocate the per-process records.
+//----------------------------------------------------------------------
+
+Statistics::~Statistics() {
+    while (!processes->IsEmpty()) {
+        delete processes->RemoveFront();
+    }
+    delete processes;
+}
+
+//----------------------------------------------------------------------
+// ProcessStats::ProcessStats
+// 	Start a record of the user time given to a process.
+//
+//	"name" is the name of the program (copied), NULL if unknown
+//	"pid" is the process id
+//----------------------------------------------------------------------
+
+ProcessStats::ProcessStats(char *name, int pid) {
+    const char *known = (name != NULL) ? name : "main";
+
+    this->name = new char[strlen(known) + 1];
+    strcpy(this->name, known);
+    this->pid = pid;
+    userTicks = 0;
+    tickets = 0;
+}
+
+ProcessStats::~ProcessStats() { delete[] name; }
+
+//----------------------------------------------------------------------
+// Statistics::NewProcess
+// 	Return a new record of the user time given to a process.  The
+//	record is kept, and printed by Print, after the process exits.
+//----------------------------------------------------------------------
+
+ProcessStats *Statistics::NewProcess(char *name, int pid) {
+    ProcessStats *record = new ProcessStats(name, pid);
+
+    processes->Append(record);
+    return record;
 }
 
 //----------------------------------------------------------------------
@@ -34,9 +83,28 @@ void Statistics::Print() {
     cout << ", system " << systemTicks << ", user " << userTicks << "\n";
     cout << "Disk I/O: reads " << numDiskReads;
     cout << ", writes " << numDiskWrites << "\n";
+    cout << "Buffer cache: hits " << numCacheHits;
+    cout << ", misses " << numCacheMisses << ", hit ratio "
+         << (numCacheHits + numCacheMisses > 0
+                 ? 100.0 * numCacheHits / (numCacheHits + numCacheMisses)
+                 : 0)
+         << "%\n";
     cout << "Console I/O: reads " << numConsoleCharsRead;
     cout << ", writes " << numConsoleCharsWritten << "\n";
-    cout << "Paging: faults " << numPageFaults << "\n";
+    cout << "Paging: faults " << numPageFaults;
+    cout << ", evictions " << numPageEvictions;
+    cout << ", prefetched " << numPagesPrefetched << "\n";
     cout << "Network I/O: packets received " << numPacketsRecvd;
     cout << ", sent " << numPacketsSent << "\n";
+
+    ListIterator<ProcessStats *> iter(processes);
+    for (; !iter.IsDone(); iter.Next()) {
+        ProcessStats *record = iter.Item();
+
+        cout << "Process " << record->pid << " (" << record->name
+             << "): user " << record->userTicks << ", share "
+             << (userTicks > 0 ? 100.0 * record->userTicks / userTicks : 0)
+             << "%, tickets " << record->tickets << "\n";
+    }
+    SlabAllocator::PrintAll();
 }
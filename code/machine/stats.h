@@ -12,6 +12,21 @@
 #define STATS_H
 
 #include "copyright.h"
+#include "list.h"
+
+// The following class records how much user time one process got,
+// for Statistics::Print.
+
+class ProcessStats {
+   public:
+    ProcessStats(char *name, int pid);  // start a record, with no time
+    ~ProcessStats();
+
+    char *name;     // the program the process is running
+    int pid;        // its process id
+    int userTicks;  // user time charged to it so far
+    int tickets;    // its share, for stride scheduling
+};
 
 // The following class defines the statistics that are to be kept
 // about Nachos behavior -- how much time (ticks) elapsed, how
@@ -30,15 +45,27 @@ class Statistics {
 
     int numDiskReads;            // number of disk read requests
     int numDiskWrites;           // number of disk write requests
+    int numCacheHits;            // sectors found in the buffer cache
+    int numCacheMisses;          // sectors the cache had to go to disk for
     int numConsoleCharsRead;     // number of characters read from the keyboard
     int numConsoleCharsWritten;  // number of characters written to the display
     int numPageFaults;           // number of virtual memory page faults
+    int numPageEvictions;        // number of pages thrown out of memory
+    int numPagesPrefetched;      // pages loaded ahead of a fault on them
     int numPacketsSent;          // number of packets sent over the network
     int numPacketsRecvd;         // number of packets received over the network
 
-    Statistics();  // initialize everything to zero
+    Statistics();   // initialize everything to zero
+    ~Statistics();  // de-allocate the per-process records
+
+    ProcessStats *NewProcess(char *name, int pid);
+    // start keeping track of a process's
+    // share of userTicks
 
     void Print();  // print collected statistics
+
+   private:
+    List<ProcessStats *> *processes;  // one record per process
 };
 
 // Constants used to reflect the relative time an operation would
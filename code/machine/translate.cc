@@ -74,6 +74,9 @@ unsigned short ShortToMachine(unsigned short shortword) {
 //   	Returns FALSE if the translation step from virtual to physical memory
 //   	failed.
 //
+//	Pages that have already been read recently are found in the
+//	translation cache, skipping the full translation.
+//
 //	"addr" -- the virtual address to read from
 //	"size" -- the number of bytes to read (1, 2, or 4)
 //	"value" -- the place to write the result
@@ -84,12 +87,16 @@ bool Machine::ReadMem(int addr, int size, int *value) {
     ExceptionType exception;
     int physicalAddress;
 
-    DEBUG(dbgAddr, "Reading VA " << addr << ", size " << size);
+    physicalAddress = CachedTranslate(addr, size, FALSE);
+    if (physicalAddress < 0) {
+        DEBUG(dbgAddr, "Reading VA " << addr << ", size " << size);
 
-    exception = Translate(addr, &physicalAddress, size, FALSE);
-    if (exception != NoException) {
-        RaiseException(exception, addr);
-        return FALSE;
+        exception = Translate(addr, &physicalAddress, size, FALSE);
+        if (exception != NoException) {
+            RaiseException(exception, addr);
+            return FALSE;
+        }
+        CacheTranslation(addr, physicalAddress, FALSE);
     }
     switch (size) {
         case 1:
@@ -123,6 +130,12 @@ bool Machine::ReadMem(int addr, int size, int *value) {
 //   	Returns FALSE if the translation step from virtual to physical memory
 //   	failed.
 //
+//	Pages that have already been written recently are found in the
+//	translation cache, skipping the full translation.
+//
+//	With the CheckedEngine, the first word each instruction writes
+//	is remembered, with its old contents, for CrossCheck.
+//
 //	"addr" -- the virtual address to write to
 //	"size" -- the number of bytes to be written (1, 2, or 4)
 //	"value" -- the data to be written
@@ -132,13 +145,23 @@ bool Machine::WriteMem(int addr, int size, int value) {
     ExceptionType exception;
     int physicalAddress;
 
-    DEBUG(dbgAddr,
-          "Writing VA " << addr << ", size " << size << ", value " << value);
+    physicalAddress = CachedTranslate(addr, size, TRUE);
+    if (physicalAddress < 0) {
+        DEBUG(dbgAddr, "Writing VA " << addr << ", size " << size
+                                     << ", value " << value);
 
-    exception = Translate(addr, &physicalAddress, size, TRUE);
-    if (exception != NoException) {
-        RaiseException(exception, addr);
-        return FALSE;
+        exception = Translate(addr, &physicalAddress, size, TRUE);
+        if (exception != NoException) {
+            RaiseException(exception, addr);
+            return FALSE;
+        }
+        CacheTranslation(addr, physicalAddress, TRUE);
+    }
+    if (decodedPage[physicalAddress / PageSize])  // self-modifying code
+        InvalidateDecodedPage(physicalAddress / PageSize);
+    if (engine == CheckedEngine && checkStore < 0) {  // see CrossCheck
+        checkStore = physicalAddress & ~0x3;
+        checkStoreWord = *(unsigned int *)&mainMemory[checkStore];
     }
     switch (size) {
         case 1:
@@ -162,6 +185,65 @@ bool Machine::WriteMem(int addr, int size, int value) {
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// Machine::CachedTranslate
+// 	Look for a virtual address in the translation cache.  Returns the
+//	physical address, or -1 if the address has to go through the full
+//	Translate: its page is not in the cache (or, for a write, hasn't
+//	been written yet), or the address is not aligned.
+//
+//	"virtAddr" -- the virtual address to translate
+//	"size" -- the amount of memory being read or written
+// 	"writing" -- if TRUE, the memory is being written
+//----------------------------------------------------------------------
+
+int Machine::CachedTranslate(int virtAddr, int size, bool writing) {
+    unsigned int vpn = (unsigned)virtAddr / PageSize;
+    CachedTranslation *entry = &translationCache[vpn % TranslationCacheSize];
+
+    if (entry->virtualPage != (int)vpn || (virtAddr & (size - 1)) != 0 ||
+        (writing && !entry->writable))
+        return -1;
+    return entry->physicalPage * PageSize + (unsigned)virtAddr % PageSize;
+}
+
+//----------------------------------------------------------------------
+// Machine::CacheTranslation
+// 	Remember a translation that Translate has just made (and so has
+//	set the use and, if writing, the dirty bit for).
+//
+//	Nothing is cached while address translation is being traced, so
+//	that every access still shows up in the debugging output.
+//
+//	"virtAddr" -- the virtual address that was translated
+//	"physAddr" -- the physical address it translated to
+// 	"writing" -- if TRUE, the page was written
+//----------------------------------------------------------------------
+
+void Machine::CacheTranslation(int virtAddr, int physAddr, bool writing) {
+    unsigned int vpn = (unsigned)virtAddr / PageSize;
+    CachedTranslation *entry = &translationCache[vpn % TranslationCacheSize];
+
+    if (debug->IsEnabled(dbgAddr)) return;
+    entry->virtualPage = vpn;
+    entry->physicalPage = physAddr / PageSize;
+    entry->writable = writing;
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateTranslations
+// 	The mapping from virtual to physical pages, or the use and dirty
+//	bits, may have been changed by the kernel.  Empty the translation
+//	cache, and make the threaded engine translate the PC again before
+//	going on with a basic block.
+//----------------------------------------------------------------------
+
+void Machine::InvalidateTranslations() {
+    for (int i = 0; i < TranslationCacheSize; i++)
+        translationCache[i].virtualPage = -1;
+    translationEpoch++;
+}
+
 //----------------------------------------------------------------------
 // Machine::Translate
 // 	Translate a virtual address into a physical address, using
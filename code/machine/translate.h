@@ -42,4 +42,20 @@ class TranslationEntry {
                        // page is modified.
 };
 
+// The following class defines an entry in the simulator's own cache of
+// recent translations.  It lets ReadMem and WriteMem go straight to
+// "mainMemory" for pages that have already been touched, without
+// walking the page table or TLB again.  Entries are made only after a
+// full translation has set the use bit (and, for "writable", the dirty
+// bit), so those bits are still set on the first touch of a page.
+
+class CachedTranslation {
+   public:
+    int virtualPage;   // The page number in virtual memory, or -1 if the
+                       // entry is empty.
+    int physicalPage;  // The page number in real memory.
+    bool writable;     // Has the page been written through this entry's
+                       // translation (so the dirty bit is already set)?
+};
+
 #endif
@@ -70,6 +70,13 @@ class Mail {
     PacketHeader pktHdr;     // Header appended by Network
     MailHeader mailHdr;      // Header appended by PostOffice
     char data[MaxMailSize];  // Payload -- message data
+
+    void *operator new(size_t size) { return slab->Alloc(size); }
+    void operator delete(void *p, size_t size) { slab->Free(p, size); }
+
+   private:
+    static SlabAllocator *slab;  // where messages come from, one for
+                                 // every packet received
 };
 
 // The following class defines a single mailbox, or temporary storage
@@ -0,0 +1,18 @@
+#include "syscall.h"
+
+/* Run alongside testShare2 with "nachos -sched stride -x testShare":
+ * this process holds three times the tickets of testShare2, so the
+ * statistics printed on Halt should show it with about three times
+ * the share of user time.
+ */
+int main() {
+    int i, j;
+    SetShare(300);
+    Exec("testShare2");
+    for (i = 0; i < 2000; i++) {
+        for (j = 0; j < 200; j++) {
+        }
+    }
+    PrintString("testShare done\n");
+    Halt();
+}
@@ -0,0 +1,10 @@
+#include "syscall.h"
+
+int main() {
+    int j;
+    SetShare(100);
+    while (1) {
+        for (j = 0; j < 200; j++) {
+        }
+    }
+}
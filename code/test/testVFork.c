@@ -0,0 +1,43 @@
+#include "syscall.h"
+
+/* Run with "nachos -x testVFork".  A child made by MyThreadFork
+ * (VFork) shares the pages its parent has loaded, and has to fault
+ * in the rest from the program itself.  Here the child runs code,
+ * and uses stack, that the parent never touched; it should print 36.
+ */
+
+int child();
+int deep(int n);
+
+int main() {
+    int pid;
+
+    pid = MyThreadFork(0);
+    if (pid == 0) {
+        Exit(child());
+    }
+    Join(pid);
+    PrintString("testVFork done\n");
+    Halt();
+}
+
+/* Placed after main, so their code is on pages the parent doesn't run. */
+int child() {
+    PrintNum(deep(8));
+    PrintString(" from the child\n");
+    return 0;
+}
+
+/* Each call takes more than a page of stack. */
+int deep(int n) {
+    char frame[200];
+    int i;
+
+    for (i = 0; i < 200; i++) {
+        frame[i] = n;
+    }
+    if (n == 0) {
+        return frame[199];
+    }
+    return deep(n - 1) + frame[0];
+}
@@ -1,8 +1,7 @@
 // alarm.cc
 //	Routines to use a hardware timer device to provide a
-//	software alarm clock.  For now, we just provide time-slicing.
-//
-//	Not completely implemented.
+//	software alarm clock: time-slicing, and putting threads to
+//	sleep for a while.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -37,14 +36,33 @@ Alarm::Alarm(bool doRandom) { timer = new Timer(doRandom, this); }
 //	was interrupted.
 //
 //	For now, just provide time-slicing.  Only need to time slice
-//      if we're currently running something (in other words, not idle).
+//      if we're currently running something (in other words, not idle),
+//	and the scheduler says the running thread's time is up.
 //----------------------------------------------------------------------
 
 void Alarm::CallBack() {
     Interrupt *interrupt = kernel->interrupt;
     MachineStatus status = interrupt->getStatus();
 
-    if (status != IdleMode) {
+    if (status != IdleMode && kernel->scheduler->ShouldPreempt()) {
         interrupt->YieldOnReturn();
     }
 }
+
+//----------------------------------------------------------------------
+// Alarm::WaitUntil
+//	Suspend the current thread until "x" ticks of simulated time have
+//	gone by.  The scheduler keeps it on its sleep queue, and puts it
+//	back on the ready list from a timer interrupt.
+//
+//	"x" -- how long to sleep for
+//----------------------------------------------------------------------
+
+void Alarm::WaitUntil(int x) {
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    Thread *thread = kernel->currentThread;
+
+    kernel->scheduler->Sleep(thread, x);
+    thread->Sleep(FALSE);  // idles if nothing else can run
+    (void)kernel->interrupt->SetLevel(oldLevel);
+}
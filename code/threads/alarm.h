@@ -8,8 +8,6 @@
 //	From this, we provide the ability for a thread to be
 //	woken up after a delay; we also provide time-slicing.
 //
-//	NOTE: this abstraction is not completely implemented.
-//
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
@@ -29,8 +27,7 @@ class Alarm : public CallBackObj {
                                 // to "toCall" every time slice.
     ~Alarm() { delete timer; }
 
-    void WaitUntil(int x);  // suspend execution until time > now + x
-                            // this method is not yet implemented
+    void WaitUntil(int x);  // suspend execution until time >= now + x
 
    private:
     Timer *timer;  // the hardware timer device
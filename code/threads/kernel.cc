@@ -16,7 +16,11 @@
 #include "string.h"
 #include "synchconsole.h"
 #include "synchdisk.h"
+#include "synchcache.h"
+#include "swap.h"
+#include "frametable.h"
 #include "post.h"
+#include <time.h>
 
 #define MAX_PROCESS 10
 //----------------------------------------------------------------------
@@ -28,6 +32,12 @@
 Kernel::Kernel(int argc, char **argv) {
     randomSlice = FALSE;
     debugUserProg = FALSE;
+    simEngine = SwitchEngine;
+    batchTicks = FALSE;
+    schedPolicy = FifoPolicy;
+    replacePolicy = FifoReplace;
+    faultAround = FaultAroundPages;
+    diskPolicy = FifoDisk;
     consoleIn = NULL;   // default is stdin
     consoleOut = NULL;  // default is stdout
 #ifndef FILESYS_STUB
@@ -45,6 +55,67 @@ Kernel::Kernel(int argc, char **argv) {
             i++;
         } else if (strcmp(argv[i], "-s") == 0) {
             debugUserProg = TRUE;
+        } else if (strcmp(argv[i], "-e") == 0) {
+            ASSERT(i + 1 < argc);  // next argument is the engine
+            if (strcmp(argv[i + 1], "switch") == 0) {
+                simEngine = SwitchEngine;
+            } else if (strcmp(argv[i + 1], "threaded") == 0) {
+                simEngine = ThreadedEngine;
+            } else if (strcmp(argv[i + 1], "block") == 0) {
+                simEngine = BlockEngine;
+            } else if (strcmp(argv[i + 1], "check") == 0) {
+                simEngine = CheckedEngine;
+            } else {
+                ASSERTNOTREACHED();
+            }
+            i++;
+        } else if (strcmp(argv[i], "-b") == 0) {
+            batchTicks = TRUE;
+        } else if (strcmp(argv[i], "-sched") == 0) {
+            ASSERT(i + 1 < argc);  // next argument is the policy
+            if (strcmp(argv[i + 1], "fifo") == 0) {
+                schedPolicy = FifoPolicy;
+            } else if (strcmp(argv[i + 1], "mlfq") == 0) {
+                schedPolicy = MlfqPolicy;
+            } else if (strcmp(argv[i + 1], "stride") == 0) {
+                schedPolicy = StridePolicy;
+            } else {
+                ASSERTNOTREACHED();
+            }
+            i++;
+        } else if (strcmp(argv[i], "-replace") == 0) {
+            ASSERT(i + 1 < argc);  // next argument is the policy
+            if (strcmp(argv[i + 1], "fifo") == 0) {
+                replacePolicy = FifoReplace;
+            } else if (strcmp(argv[i + 1], "clock") == 0) {
+                replacePolicy = ClockReplace;
+            } else if (strcmp(argv[i + 1], "lru") == 0) {
+                replacePolicy = LruReplace;
+            } else if (strcmp(argv[i + 1], "wsclock") == 0) {
+                replacePolicy = WsClockReplace;
+            } else {
+                ASSERTNOTREACHED();
+            }
+            i++;
+        } else if (strcmp(argv[i], "-fa") == 0) {
+            ASSERT(i + 1 < argc);  // next argument is the window size
+            faultAround = atoi(argv[i + 1]);
+            ASSERT(faultAround >= 1 && faultAround <= MaxFaultAround);
+            i++;
+        } else if (strcmp(argv[i], "-disk") == 0) {
+            ASSERT(i + 1 < argc);  // next argument is the policy
+            if (strcmp(argv[i + 1], "fifo") == 0) {
+                diskPolicy = FifoDisk;
+            } else if (strcmp(argv[i + 1], "scan") == 0) {
+                diskPolicy = ScanDisk;
+            } else if (strcmp(argv[i + 1], "clook") == 0) {
+                diskPolicy = CLookDisk;
+            } else if (strcmp(argv[i + 1], "sstf") == 0) {
+                diskPolicy = SstfDisk;
+            } else {
+                ASSERTNOTREACHED();
+            }
+            i++;
         } else if (strcmp(argv[i], "-ci") == 0) {
             ASSERT(i + 1 < argc);
             consoleIn = argv[i + 1];
@@ -68,6 +139,12 @@ Kernel::Kernel(int argc, char **argv) {
         } else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-rs randomSeed]\n";
             cout << "Partial usage: nachos [-s]\n";
+            cout << "Partial usage: nachos [-e switch|threaded|block|check]\n";
+            cout << "Partial usage: nachos [-b]\n";
+            cout << "Partial usage: nachos [-sched fifo|mlfq|stride]\n";
+            cout << "Partial usage: nachos [-replace fifo|clock|lru|wsclock]\n";
+            cout << "Partial usage: nachos [-fa pages]\n";
+            cout << "Partial usage: nachos [-disk fifo|scan|clook|sstf]\n";
             cout << "Partial usage: nachos [-ci consoleIn] [-co consoleOut]\n";
 #ifndef FILESYS_STUB
             cout << "Partial usage: nachos [-nf]\n";
@@ -91,26 +168,41 @@ void Kernel::Initialize(char *userProgName /*=NULL*/) {
     currentThread = new Thread(userProgName);
     currentThread->setStatus(RUNNING);
 
-    stats = new Statistics();        // collect statistics
-    interrupt = new Interrupt;       // start up interrupt handling
-    scheduler = new Scheduler();     // initialize the ready queue
-    alarm = new Alarm(randomSlice);  // start up time slicing
-    machine = new Machine(debugUserProg);
+    stats = new Statistics();                // collect statistics
+    interrupt = new Interrupt;               // start up interrupt handling
+    scheduler = new Scheduler(schedPolicy);  // initialize the ready queue
+    alarm = new Alarm(randomSlice);          // start up time slicing
+    machine = new Machine(debugUserProg, simEngine, batchTicks);
     synchConsoleIn = new SynchConsoleInput(consoleIn);     // input from stdin
     synchConsoleOut = new SynchConsoleOutput(consoleOut);  // output to stdout
-    synchDisk = new SynchDisk();                           //
+    synchDisk = new SynchDisk(diskPolicy);
 #ifdef FILESYS_STUB
+    synchCache = NULL;  // only the swap area uses the disk
     fileSystem = new FileSystem();
 #else
+    synchCache = new SynchCache(synchDisk, NumCacheSectors);
     fileSystem = new FileSystem(formatFlag);
 #endif  // FILESYS_STUB
     postOfficeIn = new PostOfficeInput(10);
     postOfficeOut = new PostOfficeOutput(reliability);
 
     addrLock = new Semaphore("addrLock", 1);
-    gPhysPageBitMap = new Bitmap(128);
+    gPhysPageBitMap = new Bitmap(NumPhysPages);
+    frameTable = new FrameTable(NumPhysPages);
+#ifdef FILESYS_STUB
+    swap = new SwapSpace(0, NumSectors);  // the disk is otherwise unused
+#else
+    // the file system keeps the last tracks of the disk back for swap
+    swap = new SwapSpace(FirstSwapSector, NumSwapSectors);
+#endif
+    AddrSpace::SetReplacePolicy(replacePolicy);
+    AddrSpace::SetFaultAround(faultAround);
     semTab = new STable();
     pTab = new PTable(MAX_PROCESS);
+    Thread::FillStackPool(MAX_PROCESS);  // a stack ready for each process
+    if (synchCache != NULL) {
+        synchCache->StartWriteBack();
+    }
 
     interrupt->Enable();
 }
@@ -128,21 +220,25 @@ Kernel::~Kernel() {
     delete machine;
     delete synchConsoleIn;
     delete synchConsoleOut;
+    delete swap;
+    delete synchCache;
     delete synchDisk;
     delete fileSystem;
     delete postOfficeIn;
     delete postOfficeOut;
     delete pTab;
+    delete frameTable;
     delete gPhysPageBitMap;
     delete semTab;
     delete addrLock;
+    Thread::EmptyStackPool();
 
     Exit(0);
 }
 
 //----------------------------------------------------------------------
 // Kernel::ThreadSelfTest
-//      Test threads, semaphores, synchlists
+//      Test threads, semaphores, locks, synchlists
 //----------------------------------------------------------------------
 
 void Kernel::ThreadSelfTest() {
@@ -163,6 +259,9 @@ void Kernel::ThreadSelfTest() {
     synchList = new SynchList<int>;
     synchList->SelfTest(9);
     delete synchList;
+
+    // test priority donation through nested locks
+    Lock::SelfTest();
 }
 
 //----------------------------------------------------------------------
@@ -242,3 +341,140 @@ void Kernel::NetworkTest() {
 
     // Then we're done!
 }
+
+//----------------------------------------------------------------------
+// BenchTimer
+//      A simulated device timer for Kernel::InterruptBenchmark.  Each
+//	one re-arms itself with a random delay every time it goes off,
+//	until it has gone off "limit" times.
+//----------------------------------------------------------------------
+
+class BenchTimer : public CallBackObj {
+   public:
+    BenchTimer(int limit, int *running) {
+        remaining = limit;
+        numRunning = running;
+        (*numRunning)++;
+        SetInterrupt();
+    }
+
+    void CallBack() {
+        if (--remaining > 0) {
+            SetInterrupt();
+        } else {
+            (*numRunning)--;
+        }
+    }
+
+   private:
+    void SetInterrupt() {
+        kernel->interrupt->Schedule(this, 1 + RandomNumber() % (TimerTicks * 2),
+                                    TimerInt);
+    }
+
+    int remaining;    // how many more times to go off
+    int *numRunning;  // count of timers that are still going
+};
+
+//----------------------------------------------------------------------
+// Kernel::InterruptBenchmark
+//      Measure how fast the interrupt simulation schedules and
+//	delivers interrupts, with many device timers pending at once.
+//	Simulated time is advanced the way kernel code does, by
+//	re-enabling interrupts.
+//----------------------------------------------------------------------
+
+void Kernel::InterruptBenchmark() {
+    const int numTimers = 2000;
+    const int firingsPerTimer = 500;
+    BenchTimer **timers = new BenchTimer *[numTimers];
+    int running = 0;
+    int startTicks = stats->totalTicks;
+    clock_t start = clock();
+    double seconds;
+
+    for (int i = 0; i < numTimers; i++) {
+        timers[i] = new BenchTimer(firingsPerTimer, &running);
+    }
+    while (running > 0) {
+        interrupt->SetLevel(IntOff);
+        interrupt->SetLevel(IntOn);  // advances time, fires interrupts
+    }
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    cout << "Interrupt benchmark: " << numTimers * firingsPerTimer
+         << " interrupts from " << numTimers << " timers in "
+         << stats->totalTicks - startTicks << " ticks, " << seconds
+         << " seconds\n";
+    if (seconds > 0) {
+        cout << "Interrupts per second: "
+             << (int)(numTimers * firingsPerTimer / seconds) << "\n";
+    }
+
+    for (int i = 0; i < numTimers; i++) {
+        delete timers[i];
+    }
+    delete[] timers;
+}
+
+//----------------------------------------------------------------------
+// DiskBenchThread
+//      One of the threads of Kernel::DiskBenchmark.  It reads a
+//	series of "files" -- runs of a few sectors at random places on
+//	the disk -- a sector at a time, and writes every fourth one back
+//	as it was, so that nothing on the disk is changed.
+//----------------------------------------------------------------------
+
+static const int DiskBenchFiles = 20;    // files each thread reads
+static const int DiskBenchMaxFile = 8;  // most sectors in a file
+
+static void DiskBenchThread(void *arg) {
+    Semaphore *finished = (Semaphore *)arg;
+    char *data = new char[DiskBenchMaxFile * SectorSize];
+    int first, length;
+
+    for (int file = 0; file < DiskBenchFiles; file++) {
+        length = 1 + RandomNumber() % DiskBenchMaxFile;
+        first = RandomNumber() % (NumSectors - length);
+        for (int i = 0; i < length; i++) {
+            kernel->synchDisk->ReadSector(first + i, &data[i * SectorSize]);
+        }
+        if (file % 4 == 0) {
+            for (int i = 0; i < length; i++) {
+                kernel->synchDisk->WriteSector(first + i,
+                                               &data[i * SectorSize]);
+            }
+        }
+    }
+    delete[] data;
+    finished->V();
+}
+
+//----------------------------------------------------------------------
+// Kernel::DiskBenchmark
+//      Measure how the disk scheduling policy copes with many threads
+//	using the disk at once.  The time each request took, from when
+//	it was queued, is printed with the other statistics at halt.
+//----------------------------------------------------------------------
+
+void Kernel::DiskBenchmark() {
+    const int numThreads = 8;
+    Semaphore *finished = new Semaphore("disk benchmark", 0);
+    int startTicks = stats->totalTicks;
+    int startRequests = stats->numDiskReads + stats->numDiskWrites;
+
+    for (int i = 0; i < numThreads; i++) {
+        Thread *thread = new Thread("disk bench");
+
+        thread->Fork(DiskBenchThread, finished);
+    }
+    for (int i = 0; i < numThreads; i++) {
+        finished->P();
+    }
+
+    cout << "Disk benchmark: "
+         << stats->numDiskReads + stats->numDiskWrites - startRequests
+         << " requests from " << numThreads << " threads in "
+         << stats->totalTicks - startTicks << " ticks\n";
+    delete finished;
+}
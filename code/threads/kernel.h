@@ -18,12 +18,16 @@
 #include "alarm.h"
 #include "filesys.h"
 #include "machine.h"
+#include "synchdisk.h"
 
 class PostOfficeInput;
 class PostOfficeOutput;
 class SynchConsoleInput;
 class SynchConsoleOutput;
 class SynchDisk;
+class SynchCache;
+class SwapSpace;
+class FrameTable;
 class Semaphore;
 #include "bitmap.h"
 #include "stable.h"
@@ -46,6 +50,12 @@ class Kernel {
 
     void NetworkTest();  // interactive 2-machine network test
 
+    void InterruptBenchmark();  // time the interrupt simulation with
+                                // many device timers running at once
+
+    void DiskBenchmark();  // time disk requests from many threads
+                           // reading and writing at once
+
     // These are public for notational convenience; really,
     // they're global variables used everywhere.
 
@@ -58,23 +68,32 @@ class Kernel {
     SynchConsoleInput *synchConsoleIn;
     SynchConsoleOutput *synchConsoleOut;
     SynchDisk *synchDisk;
+    SynchCache *synchCache;  // the file system's sectors, in memory
     FileSystem *fileSystem;
     PostOfficeInput *postOfficeIn;
     PostOfficeOutput *postOfficeOut;
 
     Semaphore *addrLock;
     Bitmap *gPhysPageBitMap;
+    FrameTable *frameTable;  // what is in each frame of memory
+    SwapSpace *swap;         // where evicted pages go
     STable *semTab;
     PTable *pTab;
 
     int hostName;  // machine identifier
 
    private:
-    bool randomSlice;    // enable pseudo-random time slicing
-    bool debugUserProg;  // single step user program
-    double reliability;  // likelihood messages are dropped
-    char *consoleIn;     // file to read console input from
-    char *consoleOut;    // file to send console output to
+    bool randomSlice;             // enable pseudo-random time slicing
+    bool debugUserProg;           // single step user program
+    SimEngine simEngine;          // how the simulator executes user programs
+    bool batchTicks;              // batch up ticks between interrupts
+    SchedPolicy schedPolicy;      // how to choose the next thread to run
+    ReplacePolicy replacePolicy;  // how to choose a page to evict
+    int faultAround;              // pages to load on a page fault
+    DiskPolicy diskPolicy;        // how to order disk requests
+    double reliability;           // likelihood messages are dropped
+    char *consoleIn;              // file to read console input from
+    char *consoleOut;             // file to send console output to
 #ifndef FILESYS_STUB
     bool formatFlag;  // format the disk if this is true
 #endif
@@ -4,15 +4,32 @@
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
 //              -s -x <nachos file> -ci <consoleIn> -co <consoleOut>
+//              -e <engine> -b -sched <policy> -replace <policy>
+//              -fa <pages> -disk <policy>
 //              -f -cp <unix file> <nachos file>
 //              -p <nachos file> -r <nachos file> -l -D
 //              -n <network reliability> -m <machine id>
-//              -z -K -C -N
+//              -z -K -C -N -I -B
 //
 //    -d causes certain debugging messages to be printed (see debug.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
 //    -z prints the copyright message
 //    -s causes user programs to be executed in single-step mode
+//    -e selects how user instructions are simulated: "switch" (the
+//       default), "threaded", "block" (threaded, a basic block at a
+//       time), or "check" (threaded, verified against switch)
+//    -b batches up the simulated clock ticks of user instructions
+//       between interrupts, rather than ticking after each one
+//    -sched selects the scheduling policy: "fifo" (the default),
+//       "mlfq" (multi-level feedback queue), or "stride" (shares in
+//       proportion to tickets, see SetShare); see scheduler.h
+//    -replace selects how to choose a page to evict to swap when
+//       memory is full: "fifo" (the default), "clock", "lru" (aging),
+//       or "wsclock"; see addrspace.h
+//    -fa sets how many pages to load on a page fault, counting the
+//       faulting one (1 turns fault-around off); see addrspace.h
+//    -disk selects the order of waiting disk requests: "fifo" (the
+//       default), "scan", "clook" or "sstf"; see synchdisk.h
 //    -x runs a user program
 //    -ci specify file for console input (stdin is the default)
 //    -co specify file for console output (stdout is the default)
@@ -21,6 +38,8 @@
 //    -K run a simple self test of kernel threads and synchronization
 //    -C run an interactive console test
 //    -N run a two-machine network test (see Kernel::NetworkTest)
+//    -I time the interrupt simulation (see Kernel::InterruptBenchmark)
+//    -B time disk requests from many threads (see Kernel::DiskBenchmark)
 //
 //    Filesystem-related flags:
 //    -f forces the Nachos disk to be formatted
@@ -161,6 +180,8 @@ int main(int argc, char **argv) {
     bool threadTestFlag = false;
     bool consoleTestFlag = false;
     bool networkTestFlag = false;
+    bool interruptBenchFlag = false;
+    bool diskBenchFlag = false;
 #ifndef FILESYS_STUB
     char *copyUnixFileName = NULL;    // UNIX file to be copied into Nachos
     char *copyNachosFileName = NULL;  // name of copied file in Nachos
@@ -190,6 +211,10 @@ int main(int argc, char **argv) {
             consoleTestFlag = TRUE;
         } else if (strcmp(argv[i], "-N") == 0) {
             networkTestFlag = TRUE;
+        } else if (strcmp(argv[i], "-I") == 0) {
+            interruptBenchFlag = TRUE;
+        } else if (strcmp(argv[i], "-B") == 0) {
+            diskBenchFlag = TRUE;
         }
 #ifndef FILESYS_STUB
         else if (strcmp(argv[i], "-cp") == 0) {
@@ -214,7 +239,7 @@ int main(int argc, char **argv) {
         else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-z -d debugFlags]\n";
             cout << "Partial usage: nachos [-x programName]\n";
-            cout << "Partial usage: nachos [-K] [-C] [-N]\n";
+            cout << "Partial usage: nachos [-K] [-C] [-N] [-I] [-B]\n";
 #ifndef FILESYS_STUB
             cout << "Partial usage: nachos [-cp UnixFile NachosFile]\n";
             cout << "Partial usage: nachos [-p fileName] [-r fileName]\n";
@@ -243,6 +268,12 @@ int main(int argc, char **argv) {
     if (networkTestFlag) {
         kernel->NetworkTest();  // two-machine test of the network
     }
+    if (interruptBenchFlag) {
+        kernel->InterruptBenchmark();  // time the interrupt simulation
+    }
+    if (diskBenchFlag) {
+        kernel->DiskBenchmark();  // time disk requests under load
+    }
 
 #ifndef FILESYS_STUB
     if (removeFileName != NULL) {
@@ -2,7 +2,10 @@
 #include "pcb.h"
 
 PCB::PCB(int id) {
-    this->processID = kernel->currentThread->processID;
+    this->processID = id;
+    this->thread = NULL;
+    exitcode = 0;
+    numwait = 0;
     joinsem = new Semaphore("joinsem", 0);
     exitsem = new Semaphore("exitsem", 0);
     multex = new Semaphore("multex", 1);
@@ -13,13 +16,8 @@ PCB::~PCB() {
     delete exitsem;
     delete multex;
 
-    if (thread) {
-        thread->FreeSpace();
-        thread->Finish();
-        // delete thread;
-    }
-
-    delete[] filename;
+    // The thread, if it is still running, finishes itself; see
+    // PTable::ExitUpdate.
 }
 
 void StartProcess_2(void* pid) {
@@ -34,6 +32,13 @@ void StartProcess_2(void* pid) {
         space = new AddrSpace(fileName);
     } else {
         space = new AddrSpace(kernel->currentThread->pThread->space);
+        // Pages the parent never loaded are read from the program when
+        // we touch them.  Open it again, rather than share the parent's
+        // handle, since each address space closes its own.  We were
+        // given the parent's name, which is the program's.
+        kernel->currentThread->executable =
+            kernel->fileSystem->Open(kernel->currentThread->getName());
+        ASSERT(kernel->currentThread->executable != NULL);
         kernel->currentThread->RestoreUserState();
         //	    printf("regist PC Reg %d\n",
         //kernel->machine->ReadRegister(PCReg)); 	    printf("Parent PC Reg %d\n",
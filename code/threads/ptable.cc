@@ -3,23 +3,78 @@
 
 PTable::PTable(int size) {
     int i;
+    ASSERT(size > 1 && size <= MaxSlots);
     psize = size;
+    pcb = new PCB*[size];
+    generation = new int[size];
+    nextFree = new int[size];
     for (i = 0; i < size; i++) {
         pcb[i] = NULL;
+        generation[i] = 0;
+        nextFree[i] = i + 1;
     }
+    nextFree[size - 1] = -1;
     bmsem = new Semaphore("bmsem", 1);
+
+    // Slot 0, with process id 0, is the main process; it never goes on
+    // the free list.
     pcb[0] = new PCB(0);
     pcb[0]->parentID = -1;
+    freeHead = 1;
+    freeTail = size - 1;
 }
 
 PTable::~PTable() {
     int i;
     for (i = 0; i < psize; i++) {
-        if (!pcb[i]) delete pcb[i];
+        if (pcb[i]) delete pcb[i];
     }
+    delete[] pcb;
+    delete[] generation;
+    delete[] nextFree;
     delete bmsem;
 }
 
+// Double the number of slots, putting the new ones on the free list.
+// The per-process file tables grow to match.
+void PTable::Grow() {
+    int i;
+    int newSize = psize * 2;
+    if (newSize > MaxSlots) newSize = MaxSlots;
+    ASSERT(newSize > psize);
+
+    PCB** newPcb = new PCB*[newSize];
+    int* newGeneration = new int[newSize];
+    int* newNextFree = new int[newSize];
+    for (i = 0; i < psize; i++) {
+        newPcb[i] = pcb[i];
+        newGeneration[i] = generation[i];
+        newNextFree[i] = nextFree[i];
+    }
+    for (i = psize; i < newSize; i++) {
+        newPcb[i] = NULL;
+        newGeneration[i] = 0;
+        newNextFree[i] = i + 1;
+    }
+    newNextFree[newSize - 1] = -1;
+    delete[] pcb;
+    delete[] generation;
+    delete[] nextFree;
+    pcb = newPcb;
+    generation = newGeneration;
+    nextFree = newNextFree;
+
+    // the free list is empty, or we wouldn't be growing
+    freeHead = psize;
+    freeTail = newSize - 1;
+    DEBUG(dbgSys, "PTable grown from " << psize << " to " << newSize
+                                       << " slots");
+    psize = newSize;
+#ifdef FILESYS_STUB
+    kernel->fileSystem->Resize(psize);  // a file table per slot
+#endif
+}
+
 int PTable::ExecUpdate() {
     bmsem->P();
 
@@ -31,14 +86,15 @@ int PTable::ExecUpdate() {
         return -1;
     }
 
-    pcb[index] = new PCB(index);
+    int pid = (generation[index] << PidSlotBits) | index;
+    pcb[index] = new PCB(pid);
     char* name = kernel->currentThread->getName();
     char nullname[20] = {'\0'};
     pcb[index]->SetFileName(nullname);
     // kernel->fileSystem->Renew(index);
 
     pcb[index]->parentID = kernel->currentThread->processID;
-    int pid = pcb[index]->Exec2(name, index);
+    pid = pcb[index]->Exec2(name, pid);
 
     bmsem->V();
     return pid;
@@ -74,9 +130,10 @@ int PTable::ExecUpdate(char* name) {
         return -1;
     }
 
-    // Nếu có slot trống thì khởi tạo một PCB mới với processID chính là index
-    // của slot này
-    pcb[index] = new PCB(index);
+    // Nếu có slot trống thì khởi tạo một PCB mới với processID gồm index
+    // của slot này và generation của nó
+    int pid = (generation[index] << PidSlotBits) | index;
+    pcb[index] = new PCB(pid);
     pcb[index]->SetFileName(name);
     kernel->fileSystem->Renew(index);
 
@@ -84,7 +141,7 @@ int PTable::ExecUpdate(char* name) {
     pcb[index]->parentID = kernel->currentThread->processID;
 
     // Gọi thực thi phương thức Exec của lớp PCB.
-    int pid = pcb[index]->Exec(name, index);
+    pid = pcb[index]->Exec(name, pid);
 
     // Gọi bmsem->V()
     bmsem->V();
@@ -107,56 +164,89 @@ int PTable::ExitUpdate(int exitcode) {
     }
 
     // Ngược lại gọi SetExitCode để đặt exitcode cho tiến trình gọi.
-    pcb[id]->SetExitCode(exitcode);
-    pcb[pcb[id]->parentID]->DecNumWait();
+    PCB* process = Lookup(id);
+    PCB* parent = Lookup(process->parentID);
+    process->SetExitCode(exitcode);
+    if (parent != NULL) parent->DecNumWait();
 
     // Gọi JoinRelease để giải phóng tiến trình cha đang đợi nó (nếu có)
     // và ExitWait() để xin tiến trình cha cho phép thoát.
-    pcb[id]->JoinRelease();
-    pcb[id]->ExitWait();
+    process->JoinRelease();
+    process->ExitWait();
 
+    // Free the slot before finishing the thread, since Finish never
+    // returns.
     Remove(id);
-    return exitcode;
+    kernel->currentThread->FreeSpace();
+    kernel->currentThread->Finish();
+    ASSERTNOTREACHED();
 }
 
 int PTable::JoinUpdate(int id) {
     // Ta kiểm tra tính hợp lệ của processID id và kiểm tra tiến trình gọi Join
     // có phải là cha của tiến trình có processID là id hay không. Nếu không
     // thỏa, ta báo lỗi hợp lý và trả về -1.
-    if (id < 0 || id >= psize || pcb[id] == NULL ||
-        pcb[id]->parentID != kernel->currentThread->processID) {
+    PCB* process = Lookup(id);
+    PCB* parent;
+    if (process == NULL ||
+        process->parentID != kernel->currentThread->processID ||
+        (parent = Lookup(process->parentID)) == NULL) {
         DEBUG(dbgSys, "\nPTable::Join : Can't not join.\n");
         return -1;
     }
 
     // Tăng numwait và gọi JoinWait() để chờ tiến trình con thực hiện.
-    pcb[pcb[id]->parentID]->IncNumWait();
-    pcb[id]->JoinWait();
+    parent->IncNumWait();
+    process->JoinWait();
 
     // Sau khi tiến trình con thực hiện xong, tiến trình đã được giải phóng
 
     // Xử lý exitcode.
-    int exit_code = pcb[id]->GetExitCode();
+    int exit_code = process->GetExitCode();
     // ExitRelease() để cho phép tiến trình con thoát.
-    pcb[id]->ExitRelease();
+    process->ExitRelease();
     return exit_code;
 }
 
+// Take a slot off the free list, growing the table if there are none
+// left.  Returns -1 if the table can't grow any further.
 int PTable::GetFreeSlot() {
-    int i;
-    for (i = 0; i < psize; i++) {
-        if (!pcb[i]) return i;
+    if (freeHead < 0) {
+        if (psize >= MaxSlots) return -1;
+        Grow();
     }
-    return -1;
+    int index = freeHead;
+    freeHead = nextFree[index];
+    nextFree[index] = -1;
+    return index;
+}
+
+PCB* PTable::Lookup(int pid) {
+    if (pid < 0 || Slot(pid) >= psize) return NULL;
+    PCB* process = pcb[Slot(pid)];
+    if (process == NULL || process->processID != pid) return NULL;
+    return process;
 }
 
-bool PTable::IsExist(int pid) { return pcb[pid] != NULL; }
+bool PTable::IsExist(int pid) { return Lookup(pid) != NULL; }
 
+// Free the process's slot, moving the slot on to its next generation,
+// and put it at the end of the free list.
 void PTable::Remove(int pid) {
-    if (pcb[pid] != NULL) {
-        delete pcb[pid];
-        pcb[pid] = NULL;
+    PCB* process = Lookup(pid);
+    if (process == NULL) return;
+
+    int index = Slot(pid);
+    pcb[index] = NULL;
+    generation[index] = (generation[index] + 1) % MaxGeneration;
+    nextFree[index] = -1;
+    if (freeHead < 0) {
+        freeHead = index;
+    } else {
+        nextFree[freeTail] = index;
     }
+    freeTail = index;
+    delete process;
 }
 
-char* PTable::GetFileName(int id) { return pcb[id]->GetFileName(); }
+char* PTable::GetFileName(int id) { return Lookup(id)->GetFileName(); }
@@ -1,18 +1,36 @@
 #ifndef PTABLE_H
 #define PTABLE_H
 
-#include "bitmap.h"
 #include "pcb.h"
 
 #define MAX_PROCESS 10
 
+// Process ids are handed out from a free list of table slots, so Exec
+// takes constant time however many processes have come and gone, and
+// the table doubles in size when it runs out of slots.
+//
+// The slot number is kept in the low bits of a process id, and the
+// slot's generation -- how many times it has been reused -- in the
+// high bits.  So an id is not handed out again until its slot has
+// been reused MaxGeneration times, and a late Join on a process that
+// has already exited fails instead of finding some newer process.
+// Freed slots go on the end of the free list, to spread reuse evenly.
+const int PidSlotBits = 16;
+const int MaxSlots = 1 << PidSlotBits;               // table size limit
+const int MaxGeneration = 1 << (31 - PidSlotBits);  // ids stay positive
+
 class PTable {
    private:
-    Bitmap* bm;
-    PCB* pcb[MAX_PROCESS];
-    int psize;
+    PCB** pcb;        // process in each slot, NULL if the slot is free
+    int* generation;  // times each slot has been reused
+    int* nextFree;    // next slot on the free list, -1 at the end
+    int freeHead;     // first free slot, -1 if none
+    int freeTail;     // last free slot
+    int psize;        // number of slots
     Semaphore* bmsem;
 
+    void Grow();  // double the number of slots
+
    public:
     PTable(int size);
     ~PTable();
@@ -24,6 +42,10 @@ class PTable {
     bool IsExist(int pid);
     void Remove(int pid);
     char* GetFileName(int id);
+
+    int Slot(int pid) { return pid & (MaxSlots - 1); }
+    PCB* Lookup(int pid);  // the process with this id, NULL if none
+    int NumSlots() { return psize; }
 };
 
-#endif
\ No newline at end of file
+#endif
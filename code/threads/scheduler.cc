@@ -11,8 +11,9 @@
 //	end up calling FindNextToRun(), and that would put us in an
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+// 	Either straight FIFO, a multi-level feedback queue that favors
+//	threads that block often, or proportional-share stride
+//	scheduling (see scheduler.h).
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -23,24 +24,43 @@
 #include "scheduler.h"
 #include "main.h"
 
+//----------------------------------------------------------------------
+// PassCompare
+//	Order threads by their stride scheduling pass.
+//----------------------------------------------------------------------
+
+static int PassCompare(Thread *x, Thread *y) {
+    if (x->pass < y->pass) {
+        return -1;
+    } else if (x->pass > y->pass) {
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
 //----------------------------------------------------------------------
 // Scheduler::Scheduler
 // 	Initialize the list of ready but not running threads.
 //	Initially, no ready threads.
+//
+//	"policy" is how to choose which ready thread runs next.
 //----------------------------------------------------------------------
 
-Scheduler::Scheduler() {
-    readyList = new List<Thread *>;
-    sleepList = new List<Thread *>;
-    toBeDestroyed = NULL;
-    hasPriority = false;
-}
-
-Scheduler::Scheduler(bool priority) {
+Scheduler::Scheduler(SchedPolicy policy) {
+    this->policy = policy;
     readyList = new List<Thread *>;
-    sleepList = new List<Thread *>;
+    for (int i = 0; i < MlfqLevels; i++) {
+        levelList[i] = new List<Thread *>;
+    }
+    strideList = new SortedList<Thread *>(PassCompare);
+    globalPass = 0;
     toBeDestroyed = NULL;
-    hasPriority = priority;
+    dispatchTime = 0;
+    lastBoost = 0;
+    numBoosts = 0;
+    numSlept = 0;
+    alarmTime = -1;
 }
 
 //----------------------------------------------------------------------
@@ -50,7 +70,10 @@ Scheduler::Scheduler(bool priority) {
 
 Scheduler::~Scheduler() {
     delete readyList;
-    delete sleepList;
+    for (int i = 0; i < MlfqLevels; i++) {
+        delete levelList[i];
+    }
+    delete strideList;
 }
 
 //----------------------------------------------------------------------
@@ -58,6 +81,11 @@ Scheduler::~Scheduler() {
 // 	Mark a thread as ready, but not running.
 //	Put it on the ready list, for later scheduling onto the CPU.
 //
+//	Under MLFQ, a thread that is waking up after blocking moves up
+//	a level, and starts a new quantum.  Under stride scheduling, such
+//	a thread is not allowed to have banked the time it was not
+//	running: its pass is brought up to the current one.
+//
 //	"thread" is the thread to be put on the ready list.
 //----------------------------------------------------------------------
 
@@ -65,13 +93,24 @@ void Scheduler::ReadyToRun(Thread *thread) {
     ASSERT(kernel->interrupt->getLevel() == IntOff);
     DEBUG(dbgThread, "Putting thread on ready list: " << thread->getName());
 
-    thread->setStatus(READY);
-    if (!hasPriority)
+    if (policy == FifoPolicy) {
         readyList->Append(thread);
-    else {
-        int priority = rand() % 100 + 1;
-        pq.push(make_pair(priority, thread));
+    } else if (policy == StridePolicy) {
+        if (thread->getStatus() != RUNNING && thread->pass < globalPass) {
+            thread->pass = globalPass;
+        }
+        strideList->Insert(thread);
+    } else {
+        CatchUpBoost(thread);
+        if (thread->getStatus() == BLOCKED) {
+            if (thread->priority > 0) {
+                thread->priority--;
+            }
+            thread->ticksUsed = 0;
+        }
+        levelList[thread->getPriority()]->Append(thread);
     }
+    thread->setStatus(READY);
 }
 
 //----------------------------------------------------------------------
@@ -85,20 +124,27 @@ void Scheduler::ReadyToRun(Thread *thread) {
 Thread *Scheduler::FindNextToRun() {
     ASSERT(kernel->interrupt->getLevel() == IntOff);
 
-    if (!hasPriority) {
+    if (policy == FifoPolicy) {
         if (readyList->IsEmpty()) {
             return NULL;
         } else {
             return readyList->RemoveFront();
         }
-    } else {
-        if (pq.empty()) {
+    } else if (policy == StridePolicy) {
+        if (strideList->IsEmpty()) {
             return NULL;
         } else {
-            Thread *thread = pq.top().second;
-            pq.pop();
+            Thread *thread = strideList->RemoveFront();
+            globalPass = thread->pass;
             return thread;
         }
+    } else {
+        for (int i = 0; i < MlfqLevels; i++) {
+            if (!levelList[i]->IsEmpty()) {
+                return levelList[i]->RemoveFront();
+            }
+        }
+        return NULL;
     }
 }
 
@@ -137,6 +183,8 @@ void Scheduler::Run(Thread *nextThread, bool finishing) {
     oldThread->CheckOverflow();  // check if the old thread
                                  // had an undetected stack overflow
 
+    Charge(oldThread);
+
     kernel->currentThread = nextThread;  // switch to the next thread
     nextThread->setStatus(RUNNING);      // nextThread is now running
 
@@ -189,48 +237,219 @@ void Scheduler::CheckToBeDestroyed() {
 //----------------------------------------------------------------------
 void Scheduler::Print() {
     cout << "Ready list contents:\n";
-    if (!hasPriority)
+    if (policy == FifoPolicy) {
         readyList->Apply(ThreadPrint);
-    else {
-        priority_queue<pair<int, Thread *>, vector<pair<int, Thread *>>,
-                       CustomComparator>
-            pq_copy = pq;
-        while (!pq_copy.empty()) {
-            cout << pq_copy.top().second->getName() << " ";
-            pq_copy.pop();
+    } else if (policy == StridePolicy) {
+        strideList->Apply(ThreadPrint);
+    } else {
+        for (int i = 0; i < MlfqLevels; i++) {
+            cout << "level " << i << ": ";
+            levelList[i]->Apply(ThreadPrint);
+            cout << "\n";
         }
-        cout << endl;
     }
 }
 
+//----------------------------------------------------------------------
+// Scheduler::ShouldPreempt
+// 	Called by the timer interrupt handler, with interrupts off, to ask
+//	whether the running thread should give up the CPU when the
+//	handler returns.
+//
+//	Under FIFO, always: every timer interrupt is a time slice.
+//
+//	Under MLFQ, if the thread has used up the quantum for its level,
+//	drop it a level and start it on a new quantum.  The thread is
+//	also preempted if a thread at a higher level is ready.  This is
+//	also where the periodic priority boost happens.
+//
+//	Under stride scheduling, if a ready thread now has a lower pass
+//	than the running one.
+//----------------------------------------------------------------------
+
+bool Scheduler::ShouldPreempt() {
+    Thread *thread = kernel->currentThread;
+
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+    if (policy == FifoPolicy) {
+        return TRUE;
+    } else if (policy == StridePolicy) {
+        Charge(thread);
+        return !strideList->IsEmpty() &&
+               strideList->Front()->pass < thread->pass;
+    }
+
+    if (kernel->stats->totalTicks - lastBoost >= MlfqBoostTicks) {
+        Boost();
+    }
+    CatchUpBoost(thread);
+    Charge(thread);
+
+    if (thread->ticksUsed >= Quantum(thread->priority)) {
+        if (thread->priority < MlfqLevels - 1) {
+            thread->priority++;
+        }
+        thread->ticksUsed = 0;
+        DEBUG(dbgThread, "Thread " << thread->getName()
+                                   << " used its quantum, now at level "
+                                   << thread->priority);
+        return TRUE;
+    }
+    for (int i = 0; i < thread->getPriority(); i++) {
+        if (!levelList[i]->IsEmpty()) {
+            return TRUE;  // someone more important is waiting
+        }
+    }
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Reprioritize
+// 	Called when a thread's MLFQ priority has changed because another
+//	thread lent it its own, or the loan was given back (see
+//	Lock::Donate and Lock::Disown).  If the thread is on
+//	the ready list, move it to the queue for its new level.
+//----------------------------------------------------------------------
+
+void Scheduler::Reprioritize(Thread *thread) {
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+
+    if (policy != MlfqPolicy || thread->getStatus() != READY) {
+        return;
+    }
+    for (int i = 0; i < MlfqLevels; i++) {
+        if (levelList[i]->IsInList(thread)) {
+            levelList[i]->Remove(thread);
+            break;
+        }
+    }
+    levelList[thread->getPriority()]->Append(thread);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Charge
+// 	Charge "thread", which has been running, for the time since it
+//	was dispatched (or last charged): towards its MLFQ quantum, and
+//	towards its stride pass, in proportion to its tickets.
+//----------------------------------------------------------------------
+
+void Scheduler::Charge(Thread *thread) {
+    int ticks = kernel->stats->totalTicks - dispatchTime;
+
+    thread->ticksUsed += ticks;
+    thread->pass += (double)ticks / thread->tickets;
+    dispatchTime = kernel->stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Boost
+// 	Move every thread back to the top MLFQ level, so that threads
+//	that have been demoted cannot starve.  The ready threads are
+//	moved now, in their current order of priority; the rest catch up
+//	when they are next looked at (see CatchUpBoost).
+//----------------------------------------------------------------------
+
+void Scheduler::Boost() {
+    DEBUG(dbgThread, "Boosting all threads to the top level");
+
+    lastBoost = kernel->stats->totalTicks;
+    numBoosts++;
+    for (int i = 1; i < MlfqLevels; i++) {
+        while (!levelList[i]->IsEmpty()) {
+            levelList[0]->Append(levelList[i]->RemoveFront());
+        }
+    }
+    ListIterator<Thread *> iter(levelList[0]);
+    for (; !iter.IsDone(); iter.Next()) {
+        CatchUpBoost(iter.Item());
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::CatchUpBoost
+// 	If there has been a priority boost since "thread" was last looked
+//	at, move it to the top level, with a new quantum.
+//----------------------------------------------------------------------
+
+void Scheduler::CatchUpBoost(Thread *thread) {
+    if (thread->boosts != numBoosts) {
+        thread->boosts = numBoosts;
+        thread->priority = 0;
+        thread->ticksUsed = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Sleep
+// 	Put a thread to sleep until simulated time reaches "ticks" from
+//	now.  The thread is kept in a queue ordered by wakeup time, and a
+//	timer interrupt is scheduled for when the first sleeper is due,
+//	so that sleeping threads cost nothing on the ticks in between.
+//
+//	The caller is expected to give up the CPU right afterwards (see
+//	Alarm::WaitUntil).
+//
+//	"thread" is the thread to put to sleep.
+//	"ticks" is how long it is to sleep for.
+//----------------------------------------------------------------------
+
 void Scheduler::Sleep(Thread *thread, int ticks) {
+    SleepingThread sleeper;
+
     ASSERT(kernel->interrupt->getLevel() == IntOff);
     DEBUG(dbgThread, "Putting thread to sleep: " << thread->getName());
 
     thread->setStatus(BLOCKED);
-    thread->setTicksUntilWakeup(ticks);
-    // if present in readyList, remove it
-
-    if (readyList->IsInList(thread)) readyList->Remove(thread);
-    if (!sleepList->IsInList(thread)) {
-        sleepList->Append(thread);
-    }
+    sleeper.when = kernel->stats->totalTicks + (ticks > 0 ? ticks : 1);
+    sleeper.sequence = numSlept++;
+    sleeper.thread = thread;
+    sleepQueue.push(sleeper);
+    SetAlarm();
 }
 
-void Scheduler::WakeUp() {
+//----------------------------------------------------------------------
+// Scheduler::CallBack
+// 	Called by the timer interrupt that was scheduled for the first
+//	sleeping thread: move every thread whose wakeup time has come to
+//	the ready list, then schedule the interrupt for the next one.
+//
+//	Interrupts may also arrive for a sleeper that has since been
+//	overtaken by one that went to sleep for less time; those find
+//	nothing to do.
+//----------------------------------------------------------------------
+
+void Scheduler::CallBack() {
+    int now = kernel->stats->totalTicks;
+
     ASSERT(kernel->interrupt->getLevel() == IntOff);
     DEBUG(dbgThread, "Waking up threads");
 
-    ListIterator<Thread *> *iter = new ListIterator<Thread *>(sleepList);
-    for (; !iter->IsDone(); iter->Next()) {
-        Thread *thread = iter->Item();
-        if (thread->getTicksUntilWakeup() == 0) {
-            sleepList->Remove(thread);
-            thread->setStatus(READY);
-            if (!readyList->IsInList(thread)) readyList->Append(thread);
-        } else {
-            thread->setTicksUntilWakeup(thread->getTicksUntilWakeup() - 1);
-        }
+    while (!sleepQueue.empty() && sleepQueue.top().when <= now) {
+        ReadyToRun(sleepQueue.top().thread);
+        sleepQueue.pop();
+    }
+    if (alarmTime <= now) {  // this is the interrupt we were waiting for
+        alarmTime = -1;
+    }
+    SetAlarm();
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SetAlarm
+// 	Schedule a timer interrupt for when the first sleeping thread is
+//	to wake up, unless one is already scheduled by then.
+//----------------------------------------------------------------------
+
+void Scheduler::SetAlarm() {
+    int when;
+
+    if (sleepQueue.empty()) {
+        return;
+    }
+    when = sleepQueue.top().when;
+    if (alarmTime == -1 || when < alarmTime) {
+        kernel->interrupt->Schedule(this, when - kernel->stats->totalTicks,
+                                    TimerInt);
+        alarmTime = when;
     }
-    delete iter;
-}
\ No newline at end of file
+}
@@ -12,18 +12,41 @@
 #include "copyright.h"
 #include "list.h"
 #include "thread.h"
+#include "callback.h"
+#include "stats.h"
 #include <queue>
 #include <cstdlib>
 #include <cmath>
 
+// The scheduling policies.  FIFO runs the ready threads in turn,
+// switching on every timer interrupt.  MLFQ (multi-level feedback
+// queue) keeps a ready queue per priority level, and always runs a
+// thread from the highest level that has one.  A thread that uses up
+// its time quantum drops a level; a thread that blocks (for I/O, for
+// example) goes up a level when it wakes up; and every so often, all
+// threads are boosted back to the top.  Stride scheduling gives each
+// thread CPU time in proportion to its tickets: it always runs the
+// ready thread that has used the least time per ticket (its "pass").
+enum SchedPolicy { FifoPolicy, MlfqPolicy, StridePolicy };
+
+const int MlfqLevels = 3;  // number of MLFQ ready queues
+const int MlfqBoostTicks = 50 * TimerTicks;  // how often all threads are
+                                             // boosted to the top level
+const int DefaultTickets = 100;  // stride scheduling share of a thread,
+const int MaxTickets = 10000;    // unless it asks for another
+
 // The following class defines the scheduler/dispatcher abstraction --
 // the data structures and operations needed to keep track of which
 // thread is running, and which threads are ready but not running.
+//
+// The scheduler also keeps the threads that are sleeping for a given
+// time, ordered by when they are to wake up.  It is called back by a
+// timer interrupt when the first of them is due.
 
-class Scheduler {
+class Scheduler : public CallBackObj {
    public:
-    Scheduler();  // Initialize list of ready threads
-    Scheduler(bool priority);
+    Scheduler(SchedPolicy policy = FifoPolicy);
+    // Initialize list of ready threads
     ~Scheduler();  // De-allocate ready list
 
     void ReadyToRun(Thread* thread);
@@ -36,37 +59,70 @@ class Scheduler {
                                 // running needs to be deleted
     void Print();               // Print contents of ready list
 
+    bool ShouldPreempt();  // Called on each timer interrupt:
+                           // should the current thread yield?
+    void Reprioritize(Thread* thread);
+    // Thread's priority has changed; if it
+    // is ready, move it to the right queue
+
     void Sleep(Thread* thread, int ticks);
-    void WakeUp();
+    // Block thread until "ticks" from now;
+    // the caller must then give up the CPU
+    void CallBack();  // Wake up the sleeping threads that
+                      // are due; called by the timer interrupt
 
-    // void SetPriority(bool hasPriority) { this->hasPriority = hasPriority; }
-    bool GetPriority() { return hasPriority; }
+    SchedPolicy getPolicy() { return policy; }
 
     // SelfTest for scheduler is implemented in class Thread
 
    private:
-    bool hasPriority;
+    SchedPolicy policy;  // how to pick the next thread to run
 
     List<Thread*>* readyList;  // queue of threads that are ready to run,
-                               // but not running
-    List<Thread*>* sleepList;  // queue of threads that are sleeping
-                               // but not running
+                               // but not running (FIFO)
+    List<Thread*>* levelList[MlfqLevels];
+    // ready queue for each MLFQ level,
+    // highest priority first
+    SortedList<Thread*>* strideList;  // ready threads, by stride pass
+    double globalPass;  // pass of the thread last dispatched
+    int dispatchTime;  // when the current thread was last
+                       // dispatched or charged for its time
+    int lastBoost;     // when threads were last boosted
+    int numBoosts;     // how many boosts there have been
+
+    int Quantum(int level) { return TimerTicks << level; }
+    // MLFQ time quantum at each level
+    void Charge(Thread* thread);  // Charge the running thread for
+                                  // the time since it was dispatched
+    void CatchUpBoost(Thread* thread);  // Apply a boost that happened
+                                        // while thread was blocked
+    void Boost();  // Move all threads to the top MLFQ level
 
     Thread* toBeDestroyed;  // finishing thread to be destroyed
                             // by the next thread that runs
 
-    struct CustomComparator {
-        bool operator()(const pair<int, Thread*>& a,
-                        const pair<int, Thread*>& b) {
-            // Compare the first elements of the pairs (the integers) in
-            // ascending order.
-            return a.first > b.first;
+    struct SleepingThread {
+        int when;               // simulated time to wake up at
+        unsigned int sequence;  // threads due at the same time wake
+                                // up in the order they went to sleep
+        Thread* thread;
+    };
+
+    struct WakeupComparator {
+        bool operator()(const SleepingThread& a, const SleepingThread& b) {
+            // Earliest wakeup time, then earliest to sleep, comes first.
+            if (a.when != b.when) return a.when > b.when;
+            return (int)(a.sequence - b.sequence) > 0;
         }
     };
 
-    priority_queue<pair<int, Thread*>, vector<pair<int, Thread*>>,
-                   CustomComparator>
-        pq;
+    priority_queue<SleepingThread, vector<SleepingThread>, WakeupComparator>
+        sleepQueue;         // threads that are sleeping, by wakeup time
+    unsigned int numSlept;  // sequence number for the next sleeper
+    int alarmTime;  // when the next wakeup interrupt is scheduled,
+                    // or -1 if none is
+    void SetAlarm();  // Make sure a wakeup interrupt is scheduled
+                      // for the first sleeping thread
 };
 
 #endif  // SCHEDULER_H
@@ -16,17 +16,20 @@
 // re-set the interrupt state back to its original value (whether
 // that be disabled or enabled).
 //
-// Once we'e implemented one set of higher level atomic operations,
-// we can implement others using that implementation.  We illustrate
-// this by implementing locks and condition variables on top of
-// semaphores, instead of directly enabling and disabling interrupts.
+// All three are implemented the same way, directly on top of that:
+// each object keeps its own queue of the threads waiting on it (a
+// ThreadQueue, linked through the threads themselves, so waiting
+// never allocates memory), and its operations run with interrupts
+// off.  A thread that has to wait puts itself on the queue and goes
+// to sleep; a thread that wakes it takes it off and makes it ready.
 //
-// Locks are implemented using a semaphore to keep track of
-// whether the lock is held or not -- a semaphore value of 0 means
-// the lock is busy; a semaphore value of 1 means the lock is free.
+// A lock is free when it has no holder.  A thread waiting for it
+// lends its priority to the holder (see Lock::Donate), and is woken,
+// most important first, when the lock is released.
 //
-// The implementation of condition variables using semaphores is
-// a bit trickier, as explained below under Condition::Wait.
+// Condition::Wait puts the thread on the condition's queue and
+// releases the lock with interrupts still off, so no Signal can be
+// missed in between.  Broadcast empties the queue in a single pass.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -35,6 +38,10 @@
 #include "copyright.h"
 #include "synch.h"
 #include "main.h"
+#include <string.h>
+
+SlabAllocator *Semaphore::slab =
+    SlabAllocator::Find("semaphore", sizeof(Semaphore));
 
 //----------------------------------------------------------------------
 // Semaphore::Semaphore
@@ -47,7 +54,6 @@
 Semaphore::Semaphore(char *debugName, int initialValue) {
     name = debugName;
     value = initialValue;
-    queue = new List<Thread *>;
 }
 
 //----------------------------------------------------------------------
@@ -56,7 +62,7 @@ Semaphore::Semaphore(char *debugName, int initialValue) {
 //	is still waiting on the semaphore!
 //----------------------------------------------------------------------
 
-Semaphore::~Semaphore() { delete queue; }
+Semaphore::~Semaphore() {}
 
 //----------------------------------------------------------------------
 // Semaphore::P
@@ -75,8 +81,8 @@ void Semaphore::P() {
     // disable interrupts
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
 
-    while (value == 0) {               // semaphore not available
-        queue->Append(currentThread);  // so go to sleep
+    while (value == 0) {              // semaphore not available
+        queue.Append(currentThread);  // so go to sleep
         currentThread->Sleep(FALSE);
     }
     value--;  // semaphore available, consume its value
@@ -99,8 +105,8 @@ void Semaphore::V() {
     // disable interrupts
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
 
-    if (!queue->IsEmpty()) {  // make thread ready.
-        kernel->scheduler->ReadyToRun(queue->RemoveFront());
+    if (!queue.IsEmpty()) {  // make thread ready.
+        kernel->scheduler->ReadyToRun(queue.RemoveFront());
     }
     value++;
 
@@ -135,6 +141,35 @@ void Semaphore::SelfTest() {
     delete ping;
 }
 
+// The following class records how long threads have had to wait for
+// the locks with a given name.  Locks come and go (one per open file,
+// say), so the records are kept by name rather than by lock, and are
+// never deallocated.
+
+class LockStats {
+   public:
+    LockStats(char *lockName) {
+        name = new char[strlen(lockName) + 1];
+        strcpy(name, lockName);
+        numWaits = totalWait = maxWait = 0;
+    }
+
+    void Record(int ticks) {  // a thread waited "ticks" for the lock
+        numWaits++;
+        totalWait += ticks;
+        if (ticks > maxWait) {
+            maxWait = ticks;
+        }
+    }
+
+    char *name;     // name of the locks
+    int numWaits;   // times a thread had to wait in Acquire
+    int totalWait;  // ticks spent waiting, over all of them
+    int maxWait;    // longest single wait
+};
+
+static List<LockStats *> *lockStats = NULL;  // one record per lock name
+
 //----------------------------------------------------------------------
 // Lock::Lock
 // 	Initialize a lock, so that it can be used for synchronization.
@@ -145,43 +180,269 @@ void Semaphore::SelfTest() {
 
 Lock::Lock(char *debugName) {
     name = debugName;
-    semaphore = new Semaphore("lock", 1);  // initially, unlocked
-    lockHolder = NULL;
+    lockHolder = NULL;  // initially, unlocked
+    nextHeld = NULL;
+
+    if (debugName == NULL) {
+        debugName = "(unnamed)";
+    }
+    if (lockStats == NULL) {
+        lockStats = new List<LockStats *>;
+    }
+    stats = NULL;
+    ListIterator<LockStats *> iter(lockStats);
+    for (; !iter.IsDone(); iter.Next()) {
+        if (strcmp(iter.Item()->name, debugName) == 0) {
+            stats = iter.Item();
+            break;
+        }
+    }
+    if (stats == NULL) {
+        stats = new LockStats(debugName);
+        lockStats->Append(stats);
+    }
 }
 
 //----------------------------------------------------------------------
 // Lock::~Lock
 // 	Deallocate a lock
 //----------------------------------------------------------------------
-Lock::~Lock() { delete semaphore; }
+Lock::~Lock() {
+    if (lockHolder != NULL) {  // don't leave it on the holder's list
+        IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+        Disown();
+        (void)kernel->interrupt->SetLevel(oldLevel);
+    }
+}
+
+//----------------------------------------------------------------------
+// Lock::Donate
+//	"thread" has to wait for a lock; lend its priority to the lock's
+//	holder, so the holder can't be kept off the CPU by threads less
+//	important than "thread".  If the holder is itself waiting for
+//	a lock, pass the loan on down the chain.
+//
+//	Priorities are MLFQ levels, so lower is more important; under
+//	the other policies everyone is at level 0 and nothing is lent.
+//----------------------------------------------------------------------
+
+void Lock::Donate(Thread *thread) {
+    int priority = thread->getPriority();
+    Lock *lock = thread->waitingOn;
+
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+    while (lock != NULL && lock->lockHolder != NULL) {
+        Thread *holder = lock->lockHolder;
+
+        if (holder->getPriority() <= priority) {
+            break;  // already at least as important; so is the
+                    // rest of the chain
+        }
+        DEBUG(dbgSynch, "Lending priority " << priority << " to "
+                                             << holder->getName()
+                                             << " for lock " << lock->name);
+        holder->donatedPriority = priority;
+        kernel->scheduler->Reprioritize(holder);
+        lock = holder->waitingOn;
+    }
+}
+
+//----------------------------------------------------------------------
+// Lock::Disown
+//	Take the lock off its holder's list of held locks, and recompute
+//	the priority lent to the holder by threads waiting for the
+//	locks it still holds.  Called with interrupts off.
+//----------------------------------------------------------------------
+
+void Lock::Disown() {
+    Thread *holder = lockHolder;
+    Lock **link = &holder->heldLocks;
+    int priority = -1;
+
+    while (*link != this) {
+        ASSERT(*link != NULL);  // must be on the list
+        link = &(*link)->nextHeld;
+    }
+    *link = nextHeld;
+    nextHeld = NULL;
+
+    for (Lock *lock = holder->heldLocks; lock != NULL; lock = lock->nextHeld) {
+        Thread *waiter = lock->waiters.Front();
+
+        for (; waiter != NULL; waiter = waiter->waitNext) {
+            if (priority < 0 || waiter->getPriority() < priority) {
+                priority = waiter->getPriority();
+            }
+        }
+    }
+    holder->donatedPriority = priority;
+    kernel->scheduler->Reprioritize(holder);
+}
 
 //----------------------------------------------------------------------
 // Lock::Acquire
 //	Atomically wait until the lock is free, then set it to busy.
-//	Equivalent to Semaphore::P(), with the semaphore value of 0
-//	equal to busy, and semaphore value of 1 equal to free.
+//	Like Semaphore::P(), the thread sleeps on the lock's queue
+//	until it finds the lock free.
 //----------------------------------------------------------------------
 
 void Lock::Acquire() {
-    semaphore->P();
-    lockHolder = kernel->currentThread;
+    Thread *currentThread = kernel->currentThread;
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    if (lockHolder != NULL) {  // lock is busy, so we have to wait
+        int start = kernel->stats->totalTicks;
+
+        currentThread->waitingOn = this;
+        while (lockHolder != NULL) {
+            waiters.Append(currentThread);  // go to sleep, lending our
+            Donate(currentThread);          // priority to the holder
+            currentThread->Sleep(FALSE);
+        }
+        currentThread->waitingOn = NULL;
+        stats->Record(kernel->stats->totalTicks - start);
+    }
+    lockHolder = currentThread;
+    nextHeld = currentThread->heldLocks;
+    currentThread->heldLocks = this;
+
+    (void)kernel->interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
 // Lock::Release
 //	Atomically set lock to be free, waking up a thread waiting
-//	for the lock, if any.
-//	Equivalent to Semaphore::V(), with the semaphore value of 0
-//	equal to busy, and semaphore value of 1 equal to free.
+//	for the lock, if any.  Like Semaphore::V(), the woken thread
+//	still has to find the lock free when it runs.
+//
+//	The most important waiter is woken first, and whatever it and
+//	the others lent us is given back.
 //
 //	By convention, only the thread that acquired the lock
 // 	may release it.
 //---------------------------------------------------------------------
 
 void Lock::Release() {
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
     ASSERT(IsHeldByCurrentThread());
+    Disown();
     lockHolder = NULL;
-    semaphore->V();
+    if (!waiters.IsEmpty()) {
+        Thread *next = waiters.Front();
+
+        for (Thread *t = next->waitNext; t != NULL; t = t->waitNext) {
+            if (t->getPriority() < next->getPriority()) {
+                next = t;
+            }
+        }
+        waiters.Remove(next);
+        kernel->scheduler->ReadyToRun(next);
+    }
+
+    (void)kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Lock::SelfTest, LowHelper, MidHelper, HighHelper
+// 	Test priority donation through nested locks, with a thread at
+//	each MLFQ level.  "low" takes two locks, one inside the other,
+//	and works holding both; "high" waits for the inner one; "mid",
+//	which needs no locks, keeps the CPU busy.  Unless "high" lends
+//	its priority to "low", "mid" always runs ahead of "low", and
+//	"high" gets the lock only once "mid" has finished.
+//
+//	Only MLFQ has priorities to lend, so under the other policies
+//	there is nothing to test.
+//----------------------------------------------------------------------
+
+static const int LowWork = 5, MidWork = 10;  // yields each one makes
+static Lock *outer, *inner;
+static Semaphore *locked, *finished;
+static int midDone;  // times "mid" has yielded so far
+
+static void LowHelper(void *) {
+    outer->Acquire();
+    inner->Acquire();
+    locked->V();
+    for (int i = 0; i < LowWork; i++) {
+        kernel->currentThread->Yield();
+    }
+    inner->Release();
+    ASSERT(kernel->currentThread->getPriority() ==
+           kernel->currentThread->priority);  // the loan is paid back
+    outer->Release();
+    finished->V();
+}
+
+static void MidHelper(void *) {
+    for (midDone = 0; midDone < MidWork; midDone++) {
+        kernel->currentThread->Yield();
+    }
+    finished->V();
+}
+
+static void HighHelper(void *) {
+    inner->Acquire();
+    ASSERT(midDone < MidWork);  // "mid" didn't starve us
+    inner->Release();
+    finished->V();
+}
+
+void Lock::SelfTest() {
+    Thread *low, *mid, *high;
+
+    if (kernel->scheduler->getPolicy() != MlfqPolicy) {
+        return;
+    }
+    outer = new Lock("outer");
+    inner = new Lock("inner");
+    locked = new Semaphore("locked", 0);
+    finished = new Semaphore("finished", 0);
+
+    low = new Thread("low");
+    low->priority = MlfqLevels - 1;
+    low->Fork((VoidFunctionPtr)LowHelper, NULL);
+    locked->P();  // until "low" holds both locks
+
+    mid = new Thread("mid");
+    mid->priority = 1;
+    mid->Fork((VoidFunctionPtr)MidHelper, NULL);
+    high = new Thread("high");
+    high->priority = 0;
+    high->Fork((VoidFunctionPtr)HighHelper, NULL);
+    for (int i = 0; i < 3; i++) {
+        finished->P();
+    }
+
+    delete finished;
+    delete locked;
+    delete inner;
+    delete outer;
+}
+
+//----------------------------------------------------------------------
+// Lock::PrintStats
+//	Print how long threads had to wait for each kind of lock, for
+//	those that were ever contended.
+//----------------------------------------------------------------------
+
+void Lock::PrintStats() {
+    if (lockStats == NULL) {
+        return;
+    }
+    ListIterator<LockStats *> iter(lockStats);
+    for (; !iter.IsDone(); iter.Next()) {
+        LockStats *record = iter.Item();
+
+        if (record->numWaits > 0) {
+            cout << "Lock \"" << record->name << "\": waits "
+                 << record->numWaits << ", worst " << record->maxWait
+                 << " ticks, average " << record->totalWait / record->numWaits
+                 << "\n";
+        }
+    }
 }
 
 //----------------------------------------------------------------------
@@ -192,26 +453,22 @@ void Lock::Release() {
 //
 //	"debugName" is an arbitrary name, useful for debugging.
 //----------------------------------------------------------------------
-Condition::Condition(char *debugName) {
-    name = debugName;
-    waitQueue = new List<Semaphore *>;
-}
+Condition::Condition(char *debugName) { name = debugName; }
 
 //----------------------------------------------------------------------
 // Condition::Condition
 // 	Deallocate the data structures implementing a condition variable.
 //----------------------------------------------------------------------
 
-Condition::~Condition() { delete waitQueue; }
+Condition::~Condition() {}
 
 //----------------------------------------------------------------------
 // Condition::Wait
 // 	Atomically release monitor lock and go to sleep.
-//	Our implementation uses semaphores to implement this, by
-//	allocating a semaphore for each waiting thread.  The signaller
-//	will V() this semaphore, so there is no chance the waiter
-//	will miss the signal, even though the lock is released before
-//	calling P().
+//	The thread goes on the condition's queue, and releases the lock,
+//	with interrupts disabled until it is asleep, so there is no
+//	chance it will miss a signal even though the lock is released
+//	first.
 //
 //	Note: we assume Mesa-style semantics, which means that the
 //	waiter must re-acquire the monitor lock when waking up.
@@ -220,16 +477,18 @@ Condition::~Condition() { delete waitQueue; }
 //----------------------------------------------------------------------
 
 void Condition::Wait(Lock *conditionLock) {
-    Semaphore *waiter;
+    Thread *currentThread = kernel->currentThread;
+    IntStatus oldLevel;
 
     ASSERT(conditionLock->IsHeldByCurrentThread());
 
-    waiter = new Semaphore("condition", 0);
-    waitQueue->Append(waiter);
+    oldLevel = kernel->interrupt->SetLevel(IntOff);
+    waitQueue.Append(currentThread);
     conditionLock->Release();
-    waiter->P();
+    currentThread->Sleep(FALSE);  // until Signal or Broadcast
+    (void)kernel->interrupt->SetLevel(oldLevel);
+
     conditionLock->Acquire();
-    delete waiter;
 }
 
 //----------------------------------------------------------------------
@@ -241,32 +500,41 @@ void Condition::Wait(Lock *conditionLock) {
 //	being woken up (unlike Hoare-style).
 //
 //	Also note: we assume the caller holds the monitor lock
-//	(unlike what is described in Birrell's paper).  This allows
-//	us to access waitQueue without disabling interrupts.
+//	(unlike what is described in Birrell's paper).  This protects
+//	waitQueue; interrupts are only disabled to make the woken
+//	thread ready.
 //
 //	"conditionLock" -- lock protecting the use of this condition
 //----------------------------------------------------------------------
 
 void Condition::Signal(Lock *conditionLock) {
-    Semaphore *waiter;
+    IntStatus oldLevel;
 
     ASSERT(conditionLock->IsHeldByCurrentThread());
 
-    if (!waitQueue->IsEmpty()) {
-        waiter = waitQueue->RemoveFront();
-        waiter->V();
+    oldLevel = kernel->interrupt->SetLevel(IntOff);
+    if (!waitQueue.IsEmpty()) {
+        kernel->scheduler->ReadyToRun(waitQueue.RemoveFront());
     }
+    (void)kernel->interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
 // Condition::Broadcast
-// 	Wake up all threads waiting on this condition, if any.
+// 	Wake up all threads waiting on this condition, if any, in a
+//	single pass over the queue.
 //
 //	"conditionLock" -- lock protecting the use of this condition
 //----------------------------------------------------------------------
 
 void Condition::Broadcast(Lock *conditionLock) {
-    while (!waitQueue->IsEmpty()) {
-        Signal(conditionLock);
+    IntStatus oldLevel;
+
+    ASSERT(conditionLock->IsHeldByCurrentThread());
+
+    oldLevel = kernel->interrupt->SetLevel(IntOff);
+    while (!waitQueue.IsEmpty()) {
+        kernel->scheduler->ReadyToRun(waitQueue.RemoveFront());
     }
+    (void)kernel->interrupt->SetLevel(oldLevel);
 }
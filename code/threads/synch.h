@@ -22,6 +22,70 @@
 #include "list.h"
 #include "main.h"
 
+// The following class defines a FIFO queue of threads waiting on a
+// synchronization object.  The threads are linked together through
+// their "waitNext" field, so putting a thread on the queue and taking
+// it off never needs to allocate memory.  A thread can be waiting on
+// only one queue at a time.
+//
+// As with the rest of the synchronization routines, the caller must
+// disable interrupts (or otherwise ensure mutual exclusion) when
+// using the queue.
+
+class ThreadQueue {
+   public:
+    ThreadQueue() { first = last = NULL; }  // initially empty
+
+    bool IsEmpty() { return first == NULL; }
+
+    void Append(Thread *thread) {  // Put thread at the end of the queue
+        thread->waitNext = NULL;
+        if (first == NULL) {
+            first = thread;
+        } else {
+            last->waitNext = thread;
+        }
+        last = thread;
+    }
+
+    Thread *RemoveFront() {  // Take the first thread off the queue
+        Thread *thread = first;
+
+        ASSERT(thread != NULL);
+        first = thread->waitNext;
+        if (first == NULL) {
+            last = NULL;
+        }
+        thread->waitNext = NULL;
+        return thread;
+    }
+
+    Thread *Front() { return first; }  // First thread on the queue;
+                                       // follow waitNext for the rest
+
+    void Remove(Thread *thread) {  // Take "thread" off the queue
+        Thread *prev = NULL;
+
+        for (Thread *t = first; t != thread; t = t->waitNext) {
+            ASSERT(t != NULL);  // thread must be on the queue
+            prev = t;
+        }
+        if (prev == NULL) {
+            first = thread->waitNext;
+        } else {
+            prev->waitNext = thread->waitNext;
+        }
+        if (last == thread) {
+            last = prev;
+        }
+        thread->waitNext = NULL;
+    }
+
+   private:
+    Thread *first;  // Head of the queue, NULL if empty
+    Thread *last;   // Last thread on the queue
+};
+
 // The following class defines a "semaphore" whose value is a non-negative
 // integer.  The semaphore has only two operations P() and V():
 //
@@ -47,11 +111,15 @@ class Semaphore {
     void V();         // they are both *atomic*
     void SelfTest();  // test routine for semaphore implementation
 
+    void *operator new(size_t size) { return slab->Alloc(size); }
+    void operator delete(void *p, size_t size) { slab->Free(p, size); }
+
    private:
-    char *name;  // useful for debugging
-    int value;   // semaphore value, always >= 0
-    List<Thread *> *queue;
-    // threads waiting in P() for the value to be > 0
+    char *name;         // useful for debugging
+    int value;          // semaphore value, always >= 0
+    ThreadQueue queue;  // threads waiting in P() for the value to be > 0
+
+    static SlabAllocator *slab;  // where semaphores come from
 };
 
 // The following class defines a "lock".  A lock can be BUSY or FREE.
@@ -65,6 +133,17 @@ class Semaphore {
 // In addition, by convention, only the thread that acquired the lock
 // may release it.  As with semaphores, you can't read the lock value
 // (because the value might change immediately after you read it).
+//
+// Under the MLFQ scheduler, a thread that has to wait for a lock
+// lends its priority to the holder, and on to whoever the holder is
+// waiting for in turn, so that a low priority thread can't keep a
+// high priority one waiting indefinitely.  The loan is paid back
+// when the lock is released.
+//
+// Each lock also records how long threads had to wait for it; the
+// worst case for each lock name is printed when Nachos halts.
+
+class LockStats;
 
 class Lock {
    public:
@@ -79,12 +158,23 @@ class Lock {
     // return true if the current thread
     // holds this lock.
 
-    // Note: SelfTest routine provided by SynchList
+    // Note: more tests of locks are provided by SynchList
+
+    static void SelfTest();    // test priority donation
+    static void PrintStats();  // print blocking times of contended locks
 
    private:
-    char *name;            // debugging assist
-    Thread *lockHolder;    // thread currently holding lock
-    Semaphore *semaphore;  // we use a semaphore to implement lock
+    char *name;           // debugging assist
+    Thread *lockHolder;   // thread currently holding lock, NULL if FREE
+    ThreadQueue waiters;  // threads waiting in Acquire
+    Lock *nextHeld;       // next lock held by lockHolder
+    LockStats *stats;     // blocking times, shared by all locks
+                          // with the same name
+
+    static void Donate(Thread *thread);  // lend thread's priority to
+                                         // the locks it waits behind
+    void Disown();  // take the lock off its holder's list of held
+                    // locks, and recompute what it is lent
 };
 
 // The following class defines a "condition variable".  A condition
@@ -138,6 +228,6 @@ class Condition {
 
    private:
     char *name;
-    List<Semaphore *> *waitQueue;  // list of waiting threads
+    ThreadQueue waitQueue;  // threads waiting on the condition
 };
 #endif  // SYNCH_H
@@ -25,6 +25,43 @@
 // this is put at the top of the execution stack, for detecting stack overflows
 const int STACK_FENCEPOST = 0xdedbeef;
 
+// Stacks that are not in use, each with its guard pages still set up.
+// They are chained together through their first word.
+static int *stackPool = NULL;
+static int numPooledStacks = 0;
+
+//----------------------------------------------------------------------
+// NewStack
+//	Return a thread execution stack, from the pool if there is one,
+//	else freshly allocated with guard pages on either side.
+//----------------------------------------------------------------------
+
+static int *NewStack() {
+    int *stack = stackPool;
+
+    if (stack == NULL) {
+        return (int *)AllocBoundedArray(StackSize * sizeof(int));
+    }
+    stackPool = *(int **)stack;
+    numPooledStacks--;
+    return stack;
+}
+
+//----------------------------------------------------------------------
+// FreeStack
+//	Return a stack to the pool, or to the host if the pool is full.
+//----------------------------------------------------------------------
+
+static void FreeStack(int *stack) {
+    if (numPooledStacks == MaxPooledStacks) {
+        DeallocBoundedArray((char *)stack, StackSize * sizeof(int));
+        return;
+    }
+    *(int **)stack = stackPool;
+    stackPool = stack;
+    numPooledStacks++;
+}
+
 //----------------------------------------------------------------------
 // Thread::Thread
 // 	Initialize a thread control block, so that we can then call
@@ -40,6 +77,18 @@ Thread::Thread(char *threadName, bool _has_dynamic_name /*=false*/) {
     stack = NULL;
     pThread = NULL;
     status = JUST_CREATED;
+    processID = 0;
+    priority = 0;
+    ticksUsed = 0;
+    boosts = 0;
+    tickets = DefaultTickets;
+    pass = 0;
+    usage = NULL;
+    waitNext = NULL;
+    donatedPriority = -1;
+    heldLocks = NULL;
+    waitingOn = NULL;
+    executable = NULL;
     for (int i = 0; i < MachineStateSize; i++) {
         machineState[i] = NULL;  // not strictly necessary, since
                                  // new thread ignores contents
@@ -64,8 +113,7 @@ Thread::~Thread() {
     DEBUG(dbgThread, "Deleting thread: " << name);
 
     ASSERT(this != kernel->currentThread);
-    if (stack != NULL)
-        DeallocBoundedArray((char *)stack, StackSize * sizeof(int));
+    if (stack != NULL) FreeStack(stack);
     if (has_dynamic_name) delete[] name;
 }
 
@@ -105,6 +153,33 @@ void Thread::Fork(VoidFunctionPtr func, void *arg) {
     (void)interrupt->SetLevel(oldLevel);
 }
 
+//----------------------------------------------------------------------
+// Thread::FillStackPool
+// 	Allocate stacks ahead of time, so that the first "count" threads
+//	forked do not need to wait for the host to allocate memory and
+//	set up guard pages.
+//----------------------------------------------------------------------
+
+void Thread::FillStackPool(int count) {
+    if (count > MaxPooledStacks) {
+        count = MaxPooledStacks;
+    }
+    while (numPooledStacks < count) {
+        FreeStack((int *)AllocBoundedArray(StackSize * sizeof(int)));
+    }
+}
+
+//----------------------------------------------------------------------
+// Thread::EmptyStackPool
+// 	Give all the stacks in the pool back to the host.
+//----------------------------------------------------------------------
+
+void Thread::EmptyStackPool() {
+    while (numPooledStacks > 0) {
+        DeallocBoundedArray((char *)NewStack(), StackSize * sizeof(int));
+    }
+}
+
 //----------------------------------------------------------------------
 // Thread::CheckOverflow
 // 	Check a thread's stack to see if it has overrun the space
@@ -292,7 +367,7 @@ static void *PLabelToAddr(void *plabel) {
 //----------------------------------------------------------------------
 
 void Thread::StackAllocate(VoidFunctionPtr func, void *arg) {
-    stack = (int *)AllocBoundedArray(StackSize * sizeof(int));
+    stack = NewStack();
 
 #ifdef PARISC
     // HP stack works from low addresses to high addresses
@@ -44,6 +44,7 @@
 #include "machine.h"
 #include "addrspace.h"
 #include "noff.h"
+#include "stats.h"
 
 // CPU register state to be saved on context switch.
 // The x86 needs to save only a few registers,
@@ -58,6 +59,13 @@
 // WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
 const int StackSize = (8 * 1024);  // in words
 
+// Stacks of threads that have been deleted are kept for reuse, up to
+// this many, so that forking a thread does not normally need to ask
+// the host for memory and guard pages.
+const int MaxPooledStacks = 32;
+
+class Lock;
+
 // Thread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED };
 
@@ -91,6 +99,28 @@ class Thread {
     int processID;
     int parrentID;
     int exitStatus;
+
+    // scheduling state, maintained by the Scheduler
+    int priority;         // MLFQ level, 0 is the highest
+    int ticksUsed;        // ticks run in the current MLFQ quantum
+    int boosts;           // last priority boost applied to this thread
+    int tickets;          // share of the CPU, under stride scheduling
+    double pass;          // virtual time used, under stride scheduling
+    ProcessStats *usage;  // user time given to this thread, NULL
+                          // until it first runs user code
+    Thread *waitNext;     // next thread on the same wait queue,
+                          // while blocked on a synchronization
+                          // object (see ThreadQueue in synch.h)
+    int donatedPriority;  // highest priority lent by threads waiting
+                          // for locks this one holds, -1 if none
+    Lock *heldLocks;      // locks this thread holds
+    Lock *waitingOn;      // lock this thread is waiting for, if any
+
+    int getPriority() {  // MLFQ level, counting donations
+        return (donatedPriority >= 0 && donatedPriority < priority)
+                   ? donatedPriority
+                   : priority;
+    }
     Thread *pThread;
     void FreeSpace() {
         if (space != 0) delete space;
@@ -109,11 +139,13 @@ class Thread {
 
     void CheckOverflow();  // Check if thread stack has overflowed
     void setStatus(ThreadStatus st) { status = st; }
-    void setTicksUntilWakeup(int ticks) { ticksUntilWakeup = ticks; }
-    int getTicksUntilWakeup() { return ticksUntilWakeup; }
+    ThreadStatus getStatus() { return status; }
     char *getName() { return (name); }
     void Print() { cout << name; }
     void SelfTest();  // test whether thread impl is working
+
+    static void FillStackPool(int count);  // Allocate stacks ahead of time
+    static void EmptyStackPool();          // Give pooled stacks back
     OpenFile *executable;
     NoffHeader noffH;
 
@@ -124,7 +156,6 @@ class Thread {
                           // NULL if this is the main thread
                           // (If NULL, don't deallocate stack)
     ThreadStatus status;  // ready, running or blocked
-    int ticksUntilWakeup;
     char *name;
 
     void StackAllocate(VoidFunctionPtr func, void *arg);
@@ -21,6 +21,81 @@
 #include "machine.h"
 #include "noff.h"
 #include "synch.h"
+#include "hash.h"
+#include "swap.h"
+#include "frametable.h"
+
+// What is in each frame, who is using it, and how recently, is kept
+// in kernel->frameTable.  Only a frame mapped by a single address
+// space can be evicted; shared frames (code, and pages shared with a
+// fork) have no owner, and stay in memory until they are freed.
+
+// WSClock treats a page not seen in use for this many ticks as
+// having left the process's working set.
+static const int WorkingSetWindow = 2000;
+
+ReplacePolicy AddrSpace::replacePolicy = FifoReplace;
+int AddrSpace::faultAround = FaultAroundPages;
+
+// Pages of code are read-only, so every process running the same
+// program can share one copy of each.  The pages in memory are kept
+// in a hash table, keyed by the program and the page's offset in it;
+// the table holds no reference of its own, so a page drops out of it
+// when the last process using it exits.
+//
+// Programs are identified by file name, each given a number the
+// first time it is run.
+
+class TextKey {
+   public:
+    int file;    // which program
+    int offset;  // where the page starts in it
+
+    bool operator==(const TextKey &other) const {
+        return file == other.file && offset == other.offset;
+    }
+};
+
+class TextPage {
+   public:
+    TextKey key;
+    int frame;  // where the page is in memory
+};
+
+static TextKey TextPageKey(TextPage *page) { return page->key; }
+static unsigned TextHash(TextKey key) {
+    return (unsigned)key.file * 31 + (unsigned)key.offset / PageSize;
+}
+
+static HashTable<TextKey, TextPage *> *textPages = NULL;
+static TextPage *textPageIn[NumPhysPages];  // text page each frame holds,
+                                             // NULL if none
+static List<char *> *textFiles = NULL;      // names of programs run
+
+//----------------------------------------------------------------------
+// TextFileNumber
+// 	Return the number given to the program "fileName", giving it
+//	one if this is the first time it has been run.
+//----------------------------------------------------------------------
+
+static int TextFileNumber(char *fileName) {
+    int number = 0;
+
+    if (textFiles == NULL) {
+        textFiles = new List<char *>;
+        textPages = new HashTable<TextKey, TextPage *>(TextPageKey, TextHash);
+    }
+    ListIterator<char *> iter(textFiles);
+    for (; !iter.IsDone(); iter.Next(), number++) {
+        if (strcmp(iter.Item(), fileName) == 0) {
+            return number;
+        }
+    }
+    char *name = new char[strlen(fileName) + 1];
+    strcpy(name, fileName);
+    textFiles->Append(name);
+    return number;
+}
 
 //----------------------------------------------------------------------
 // SwapHeader
@@ -76,46 +151,78 @@ AddrSpace::AddrSpace() {
 
     // // zero out the entire address space
     // bzero(kernel->machine->mainMemory, MemorySize);
+    copyOnWrite = NULL;
+    textFile = -1;
+    swapSlot = NULL;
+    pageMap = NULL;
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::AddrSpace(AddrSpace *)
+// 	Create a copy of "parent", for a forked process.
+//
+//	Nothing is copied yet: the two address spaces share every page
+//	the parent has loaded, with the page marked read-only in both
+//	page tables.  Whichever writes to a page first gets its own copy
+//	(see CopyOnWrite), so a fork costs a page table, however big
+//	the process is.  Pages the parent has out on swap are the
+//	exception: they are copied to a swap slot of the child's own --
+//	or, if swap is full, brought back into memory and shared like
+//	the rest.
+//----------------------------------------------------------------------
+
 AddrSpace::AddrSpace(AddrSpace *parent) {
     int i;
-    unsigned int size;
+    char page[PageSize];
 
     kernel->addrLock->P();
 
     this->numPages = parent->numPages;
-    size = this->numPages * PageSize;
-    ASSERT(numPages <= NumPhysPages);
+    this->textFile = parent->textFile;
+    this->faultWindow = faultAround;
+    this->nextFault = -1;
 
-    if (numPages > kernel->gPhysPageBitMap->NumClear()) {
-        DEBUG(dbgAddr, "Not enough free space");
-        this->numPages = 0;
-        kernel->addrLock->V();
-        return;
+    pageTable = new TranslationEntry[numPages];
+    copyOnWrite = new bool[numPages];
+    swapSlot = new int[numPages];
+    pageMap = NULL;
+    if (parent->pageMap != NULL) {
+        pageMap = new PageSource[numPages];
+        for (i = 0; i < (int)numPages; i++) {
+            pageMap[i] = parent->pageMap[i];
+        }
     }
+    for (i = 0; i < (int)numPages; i++) {
+        TranslationEntry *entry = &parent->pageTable[i];
 
-    pageTable = new TranslationEntry[numPages];
-    for (i = 0; i < this->numPages; i++) {
-        pageTable[i].virtualPage = i;
-        pageTable[i].physicalPage = kernel->gPhysPageBitMap->FindAndSet();
-        pageTable[i].valid = TRUE;
+        pageTable[i] = *entry;
         pageTable[i].use = FALSE;
         pageTable[i].dirty = FALSE;
-        pageTable[i].readOnly = FALSE;
-        bzero(&(kernel->machine
-                    ->mainMemory[pageTable[i].physicalPage * PageSize]),
-              PageSize);
-        DEBUG(dbgAddr, "phyPage " << pageTable[i].physicalPage);
-    }
-
-    for (i = 0; i < numPages; i++) {
-        memcpy(
-            &(kernel->machine
-                  ->mainMemory[this->pageTable[i].physicalPage * PageSize]),
-            &(kernel->machine
-                  ->mainMemory[parent->pageTable[i].physicalPage * PageSize]),
-            PageSize);
+        copyOnWrite[i] = FALSE;
+        swapSlot[i] = -1;
+        if (!entry->valid && parent->swapSlot[i] >= 0) {
+            swapSlot[i] = kernel->swap->Alloc();
+            if (swapSlot[i] >= 0) {
+                kernel->swap->ReadPage(parent->swapSlot[i], page);
+                kernel->swap->WritePage(swapSlot[i], page);
+            } else if (parent->SwapIn(i)) {  // share it in memory instead
+                DEBUG(dbgAddr, "No swap left to copy page " << i);
+                pageTable[i] = *entry;
+                pageTable[i].use = FALSE;
+            } else {
+                cerr << "Out of memory: no page can be evicted\n";
+                kernel->frameTable->Print();
+                kernel->interrupt->Halt();
+            }
+        }
+        if (entry->valid) {
+            ShareFrame(entry->physicalPage);
+            if (!entry->readOnly || parent->copyOnWrite[i]) {
+                entry->readOnly = pageTable[i].readOnly = TRUE;
+                parent->copyOnWrite[i] = copyOnWrite[i] = TRUE;
+            }
+            DEBUG(dbgAddr, "Sharing phyPage " << entry->physicalPage);
+        }
     }
 
     kernel->addrLock->V();
@@ -128,11 +235,515 @@ AddrSpace::AddrSpace(AddrSpace *parent) {
 
 AddrSpace::~AddrSpace() {
     int i;
-    for (i = 0; i < numPages; i++) {
-        kernel->gPhysPageBitMap->Clear(pageTable[i].physicalPage);
+
+    kernel->addrLock->P();  // don't let anyone evict our pages meanwhile
+    for (i = 0; i < (int)numPages; i++) {
+        if (pageTable[i].valid) {
+            ReleaseFrame(pageTable[i].physicalPage);
+        }
+        if (swapSlot != NULL && swapSlot[i] >= 0) {
+            kernel->swap->Free(swapSlot[i]);
+        }
     }
+    kernel->addrLock->V();
     delete[] pageTable;
+    delete[] copyOnWrite;
+    delete[] swapSlot;
+    delete[] pageMap;
     delete kernel->currentThread->executable;
+    kernel->currentThread->executable = NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AllocFrame
+// 	Allocate a physical page frame, with one user, to hold page "vpn"
+//	of "owner" -- or, if "owner" is NULL, a page that may be shared,
+//	and so can't be evicted.  If memory is full, evict some other
+//	page to make room.  Returns -1 if there is nothing to evict.
+//
+//	Called with kernel->addrLock held.
+//----------------------------------------------------------------------
+
+int AddrSpace::AllocFrame(AddrSpace *owner, int vpn) {
+    int frame = kernel->gPhysPageBitMap->FindAndSet();
+
+    if (frame < 0) {
+        frame = Victim();
+        if (frame < 0 || !Evict(frame)) {
+            return -1;
+        }
+    }
+    kernel->frameTable->Assign(frame, owner, vpn);
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ShareFrame
+// 	Note that another page table maps "frame".  A shared frame can't
+//	be evicted, since we don't know all the page tables it is in.
+//----------------------------------------------------------------------
+
+void AddrSpace::ShareFrame(int frame) { kernel->frameTable->Share(frame); }
+
+//----------------------------------------------------------------------
+// AddrSpace::ReleaseFrame
+// 	Note that one less page table maps "frame", and free it if no
+//	others do.
+//----------------------------------------------------------------------
+
+void AddrSpace::ReleaseFrame(int frame) {
+    if (kernel->frameTable->Release(frame)) {
+        if (textPageIn[frame] != NULL) {  // no one is running it now
+            delete textPages->Remove(textPageIn[frame]->key);
+            textPageIn[frame] = NULL;
+        }
+        kernel->gPhysPageBitMap->Clear(frame);
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Victim
+// 	Choose a frame to evict, by the replacement policy.  Candidates
+//	are frames with a single owner; the policies look at the use and
+//	dirty bits the hardware sets in the owner's page table entry.
+//	Returns -1 if there are no candidates.  Pinned frames, in the
+//	middle of a transfer, are never chosen.
+//
+//	The use bits are cleared as the policies go; since a cached
+//	translation doesn't set the use bit again, the translation cache
+//	is flushed afterwards.
+//----------------------------------------------------------------------
+
+int AddrSpace::Victim() {
+    FrameTable *frames = kernel->frameTable;
+    FrameEntry *info;
+    TranslationEntry *entry;
+    int frame, i;
+    int victim = -1;
+    int now = kernel->stats->totalTicks;
+
+    switch (replacePolicy) {
+        case FifoReplace:  // oldest arrival
+            for (frame = 0; frame < NumPhysPages; frame++) {
+                if (frames->IsEvictable(frame) &&
+                    (victim < 0 || frames->Entry(frame)->loadTime <
+                                       frames->Entry(victim)->loadTime)) {
+                    victim = frame;
+                }
+            }
+            break;
+
+        case ClockReplace:  // first frame not used since the hand last
+                            // went by; two turns clear every use bit
+            for (i = 0; i < 2 * NumPhysPages && victim < 0; i++) {
+                frame = frames->NextHand();
+                if (!frames->IsEvictable(frame)) continue;
+                info = frames->Entry(frame);
+                entry = &info->owner->pageTable[info->vpn];
+                if (entry->use) {
+                    entry->use = FALSE;  // second chance
+                } else {
+                    victim = frame;
+                }
+            }
+            break;
+
+        case LruReplace:  // age every frame by its use bit, then take
+                          // the one used least recently
+            for (frame = 0; frame < NumPhysPages; frame++) {
+                if (!frames->IsEvictable(frame)) continue;
+                info = frames->Entry(frame);
+                entry = &info->owner->pageTable[info->vpn];
+                info->age = (info->age >> 1) | (entry->use ? 0x80000000 : 0);
+                entry->use = FALSE;
+                if (victim < 0 || info->age < frames->Entry(victim)->age) {
+                    victim = frame;
+                }
+            }
+            break;
+
+        case WsClockReplace: {  // clock, but a page still in the working
+                                // set is only taken if nothing else is,
+                                // and a clean page is cheaper than a
+                                // dirty one, which has to be written
+            int dirty = -1, inWorkingSet = -1;
+
+            for (i = 0; i < 2 * NumPhysPages && victim < 0; i++) {
+                frame = frames->NextHand();
+                if (!frames->IsEvictable(frame)) continue;
+                info = frames->Entry(frame);
+                entry = &info->owner->pageTable[info->vpn];
+                if (entry->use) {
+                    entry->use = FALSE;
+                    info->lastUse = now;
+                } else if (now - info->lastUse <= WorkingSetWindow) {
+                    if (inWorkingSet < 0) inWorkingSet = frame;
+                } else if (entry->dirty) {
+                    if (dirty < 0) dirty = frame;
+                } else {
+                    victim = frame;
+                }
+            }
+            if (victim < 0) {
+                victim = (dirty >= 0) ? dirty : inWorkingSet;
+            }
+            break;
+        }
+    }
+    kernel->machine->InvalidateTranslations();
+    return victim;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Evict
+// 	Throw the page in "frame" out of memory, so the frame can be
+//	reused.  The page is written to its owner's swap slot, unless it
+//	is already there and hasn't been changed since.  Returns FALSE
+//	if it had to be written, but swap is full.
+//
+//	The owner's page table entry is invalidated before the write,
+//	so a fault on the page waits for us (on addrLock) and then finds
+//	it in swap.
+//----------------------------------------------------------------------
+
+bool AddrSpace::Evict(int frame) {
+    AddrSpace *owner = kernel->frameTable->Entry(frame)->owner;
+    int vpn = kernel->frameTable->Entry(frame)->vpn;
+    TranslationEntry *entry = &owner->pageTable[vpn];
+    bool mustWrite = entry->dirty || owner->swapSlot[vpn] < 0;
+
+    ASSERT(entry->valid && entry->physicalPage == frame);
+    if (owner->swapSlot[vpn] < 0) {
+        owner->swapSlot[vpn] = kernel->swap->Alloc();
+        if (owner->swapSlot[vpn] < 0) {
+            DEBUG(dbgAddr, "Swap is full");
+            return FALSE;
+        }
+    }
+    DEBUG(dbgAddr, "Evicting page " << vpn << " from phyPage " << frame
+                                    << (mustWrite ? ", dirty" : ""));
+    entry->valid = FALSE;
+    kernel->frameTable->Disown(frame);
+    kernel->machine->InvalidateTranslations();
+    kernel->stats->numPageEvictions++;
+    if (mustWrite) {
+        kernel->frameTable->Pin(frame);
+        kernel->swap->WritePage(owner->swapSlot[vpn],
+                                &kernel->machine->mainMemory[frame * PageSize]);
+        kernel->frameTable->Unpin(frame);
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SwapIn
+// 	Bring page "vpn" back into memory from swap.  Returns FALSE if
+//	the page has never been evicted (so it has to be loaded from the
+//	program, or zeroed), or if there is no room for it.
+//
+//	Called with kernel->addrLock held, on a page fault.
+//----------------------------------------------------------------------
+
+bool AddrSpace::SwapIn(int vpn) {
+    int frame;
+
+    if (swapSlot == NULL || vpn < 0 || vpn >= (int)numPages ||
+        swapSlot[vpn] < 0) {
+        return FALSE;
+    }
+    frame = AllocFrame(this, vpn);
+    if (frame < 0) {
+        return FALSE;
+    }
+    kernel->machine->InvalidateDecodedPage(frame);
+    kernel->frameTable->Pin(frame);
+    kernel->swap->ReadPage(swapSlot[vpn],
+                           &kernel->machine->mainMemory[frame * PageSize]);
+    kernel->frameTable->Unpin(frame);
+
+    pageTable[vpn].virtualPage = vpn;
+    pageTable[vpn].physicalPage = frame;
+    pageTable[vpn].valid = TRUE;
+    pageTable[vpn].use = FALSE;
+    pageTable[vpn].dirty = FALSE;  // same as the copy in swap
+    pageTable[vpn].readOnly = FALSE;
+    kernel->machine->InvalidateTranslations();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MapSegments
+// 	Work out, once, when the program is loaded, what goes in each
+//	page of the address space: which parts of the program file
+//	"noffH" describes, at which offsets, and so what kind of page it
+//	is.  After this, a page fault needs neither the header nor any
+//	arithmetic on segments.
+//----------------------------------------------------------------------
+
+void AddrSpace::MapSegments(NoffHeader *noffH) {
+    Segment *segments[MaxPagePieces];
+    int numSegments = 0;
+    int stackStart = numPages * PageSize - UserStackSize;
+
+    segments[numSegments++] = &noffH->code;
+#ifdef RDATA
+    segments[numSegments++] = &noffH->readonlyData;
+#endif
+    segments[numSegments++] = &noffH->initData;
+
+    pageMap = new PageSource[numPages];
+    for (int vpn = 0; vpn < (int)numPages; vpn++) {
+        PageSource *source = &pageMap[vpn];
+        int start = vpn * PageSize;
+        int codeBytes = 0;
+
+        source->numPieces = 0;
+        for (int i = 0; i < numSegments; i++) {
+            Segment *segment = segments[i];
+            int lo = max(start, segment->virtualAddr);
+            int hi = min(start + (int)PageSize,
+                         segment->virtualAddr + segment->size);
+
+            if (segment->size > 0 && lo < hi) {
+                int n = source->numPieces++;
+
+                source->pieceOffset[n] = lo - start;
+                source->pieceFileAddr[n] =
+                    segment->inFileAddr + (lo - segment->virtualAddr);
+                source->pieceSize[n] = hi - lo;
+                if (segment == &noffH->code) {
+                    codeBytes = hi - lo;
+                }
+            }
+        }
+        if (codeBytes == (int)PageSize) {
+            source->kind = CodePage;
+        } else if (source->numPieces > 0) {
+            source->kind = DataPage;
+        } else if (start + (int)PageSize > stackStart) {
+            source->kind = StackPage;
+        } else {
+            source->kind = BssPage;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsSharedText
+// 	Return TRUE if page "vpn" lies entirely within the program's code,
+//	so it can be shared with other processes running the program.
+//----------------------------------------------------------------------
+
+bool AddrSpace::IsSharedText(int vpn) {
+    return textFile >= 0 && pageMap != NULL &&
+           pageMap[vpn].kind == CodePage;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::NeedsLoading
+// 	Return TRUE if page "vpn" has never been in memory: it isn't
+//	there now, it isn't out on swap, and it isn't shared code.
+//----------------------------------------------------------------------
+
+bool AddrSpace::NeedsLoading(int vpn) {
+    return vpn >= 0 && vpn < (int)numPages && !pageTable[vpn].valid &&
+           (swapSlot == NULL || swapSlot[vpn] < 0) && !IsSharedText(vpn);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FaultIn
+// 	Load page "vpn", on its first fault, and with it the pages after
+//	it that haven't been loaded yet either -- "fault-around" -- so
+//	that they don't fault in turn.  Each page is filled in from its
+//	pieces of the program file, as worked out by MapSegments, and
+//	zeroed elsewhere.  Pieces that follow on from each other, both in
+//	the file and in the window, are read together, so a run of data
+//	pages takes one read; uninitialized data and stack pages are
+//	just zeroed, without touching the file.
+//
+//	The window widens while faults come in order, since then the
+//	process is probably working its way through an array.  Pages
+//	after "vpn" are only loaded into free frames: nothing is evicted
+//	for a page that may not be wanted.  Returns FALSE if there is no
+//	frame even for "vpn".
+//
+//	Called with kernel->addrLock held, on a page fault.
+//----------------------------------------------------------------------
+
+bool AddrSpace::FaultIn(int vpn) {
+    OpenFile *executable = kernel->currentThread->executable;
+    int first = vpn, last = vpn, page, frame;
+    char *buffer = NULL;
+    int runStart = 0, runFileAddr = 0, runSize = 0;
+
+    if (vpn == nextFault) {  // sequential; look further ahead
+        faultWindow = min(faultWindow * 2, MaxFaultAround);
+    } else {
+        faultWindow = faultAround;
+    }
+    while (last - first + 1 < faultWindow && NeedsLoading(last + 1) &&
+           last - first + 1 < kernel->gPhysPageBitMap->NumClear()) {
+        last++;
+    }
+
+    // Read the window's pieces of the file, if it has any, into a
+    // buffer, a run of adjoining pieces at a time.
+    for (page = first; page <= last; page++) {
+        PageSource *source = &pageMap[page];
+
+        for (int i = 0; i < source->numPieces; i++) {
+            int at = (page - first) * PageSize + source->pieceOffset[i];
+
+            if (buffer == NULL) {
+                buffer = new char[(last - first + 1) * PageSize];
+                bzero(buffer, (last - first + 1) * PageSize);
+            }
+            if (runSize > 0 && at == runStart + runSize &&
+                source->pieceFileAddr[i] == runFileAddr + runSize) {
+                runSize += source->pieceSize[i];  // carries on the run
+                continue;
+            }
+            if (runSize > 0) {
+                executable->ReadAt(buffer + runStart, runSize, runFileAddr);
+            }
+            runStart = at;
+            runFileAddr = source->pieceFileAddr[i];
+            runSize = source->pieceSize[i];
+        }
+    }
+    if (runSize > 0) {
+        executable->ReadAt(buffer + runStart, runSize, runFileAddr);
+    }
+
+    for (page = first; page <= last; page++) {
+        char *memory;
+
+        frame = AllocFrame(this, page);
+        if (frame < 0) {
+            break;  // can only happen for the first page
+        }
+        memory = &kernel->machine->mainMemory[frame * PageSize];
+        kernel->machine->InvalidateDecodedPage(frame);
+        if (pageMap[page].numPieces == 0) {  // bss or stack
+            bzero(memory, PageSize);
+        } else {
+            bcopy(buffer + (page - first) * PageSize, memory, PageSize);
+        }
+        pageTable[page].virtualPage = page;
+        pageTable[page].physicalPage = frame;
+        pageTable[page].valid = TRUE;
+        pageTable[page].use = FALSE;
+        pageTable[page].dirty = FALSE;
+        pageTable[page].readOnly = FALSE;
+        DEBUG(dbgAddr, "Loaded page " << page << " into phyPage " << frame);
+        if (page != vpn) {
+            kernel->stats->numPagesPrefetched++;
+        }
+    }
+    delete[] buffer;  // may be NULL
+    nextFault = page;
+    kernel->machine->InvalidateTranslations();
+    return page > first;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MapTextPage
+// 	Map virtual page "vpn", if it lies entirely within the program's
+//	code, read-only onto the copy of it shared by every process
+//	running the program; if there is no copy in memory yet, load one.
+//	Returns FALSE if the page isn't all code (or memory is full), in
+//	which case the caller loads a private copy.
+//
+//	Called with kernel->addrLock held, on a page fault.
+//----------------------------------------------------------------------
+
+bool AddrSpace::MapTextPage(int vpn) {
+    TextKey key;
+    TextPage *page;
+
+    if (!IsSharedText(vpn)) {
+        return FALSE;
+    }
+    key.file = textFile;
+    key.offset = pageMap[vpn].pieceFileAddr[0];  // all code: one piece
+
+    if (textPages->Find(key, &page)) {
+        ShareFrame(page->frame);
+        DEBUG(dbgAddr, "Sharing text page " << vpn << " in phyPage "
+                                            << page->frame);
+    } else {
+        int frame = AllocFrame();
+
+        if (frame < 0) {
+            return FALSE;
+        }
+        kernel->machine->InvalidateDecodedPage(frame);
+        kernel->currentThread->executable->ReadAt(
+            &kernel->machine->mainMemory[frame * PageSize], PageSize,
+            key.offset);
+        page = new TextPage;
+        page->key = key;
+        page->frame = frame;
+        textPages->Insert(page);
+        textPageIn[frame] = page;
+        DEBUG(dbgAddr, "Loaded text page " << vpn << " into phyPage "
+                                           << frame);
+    }
+
+    pageTable[vpn].virtualPage = vpn;
+    pageTable[vpn].physicalPage = page->frame;
+    pageTable[vpn].valid = TRUE;
+    pageTable[vpn].use = FALSE;
+    pageTable[vpn].dirty = FALSE;
+    pageTable[vpn].readOnly = TRUE;
+    kernel->machine->InvalidateTranslations();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyOnWrite
+// 	Handle the first write to a page shared with a clone: copy the
+//	page into a frame of our own, unless no one else is using it any
+//	more, and make it writable.  Returns FALSE if the page isn't
+//	copy-on-write, so the write really is an error.
+//
+//	Called with kernel->addrLock held.
+//----------------------------------------------------------------------
+
+bool AddrSpace::CopyOnWrite(int vpn) {
+    TranslationEntry *entry;
+    int frame;
+
+    if (vpn < 0 || vpn >= (int)numPages || copyOnWrite == NULL ||
+        !copyOnWrite[vpn]) {
+        return FALSE;
+    }
+    entry = &pageTable[vpn];
+    ASSERT(entry->valid);
+
+    if (kernel->frameTable->Entry(entry->physicalPage)->refCount > 1) {
+        frame = AllocFrame(this, vpn);
+        if (frame < 0) {
+            DEBUG(dbgAddr, "No free frame to copy page " << vpn);
+            return FALSE;
+        }
+        kernel->machine->InvalidateDecodedPage(frame);
+        memcpy(&kernel->machine->mainMemory[frame * PageSize],
+               &kernel->machine->mainMemory[entry->physicalPage * PageSize],
+               PageSize);
+        DEBUG(dbgAddr, "Copied page " << vpn << " from phyPage "
+                                      << entry->physicalPage << " to "
+                                      << frame);
+        ReleaseFrame(entry->physicalPage);
+        entry->physicalPage = frame;
+    } else {
+        // ours alone now
+        kernel->frameTable->Adopt(entry->physicalPage, this, vpn);
+    }
+    entry->readOnly = FALSE;
+    copyOnWrite[vpn] = FALSE;
+    kernel->machine->InvalidateTranslations();
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -148,6 +759,14 @@ AddrSpace::~AddrSpace() {
 AddrSpace::AddrSpace(char *fileName) {
     OpenFile *executable = kernel->fileSystem->Open(fileName);
     NoffHeader noffH;
+    pageTable = NULL;
+    numPages = 0;
+    faultWindow = faultAround;
+    nextFault = -1;
+    copyOnWrite = NULL;
+    textFile = -1;
+    swapSlot = NULL;
+    pageMap = NULL;
     unsigned int i, size, j, offset;
     unsigned int numCodePage,
         numDataPage;  // số trang cho phần code và phần initData
@@ -167,22 +786,22 @@ AddrSpace::AddrSpace(char *fileName) {
     ASSERT(noffH.noffMagic == NOFFMAGIC);
     kernel->currentThread->executable = executable;
     kernel->currentThread->noffH = noffH;
+    textFile = TextFileNumber(fileName);
     kernel->addrLock->P();
     // how big is address space?
     size = noffH.code.size + noffH.initData.size + noffH.uninitData.size +
            UserStackSize;  // we need to increase the size
                            // to leave room for the stack
+#ifdef RDATA
+    size += noffH.readonlyData.size;
+#endif
     numPages = divRoundUp(size, PageSize);
     size = numPages * PageSize;
 
-    ASSERT(numPages <= NumPhysPages);  // check we're not trying
-                                       // to run anything too big --
-                                       // at least until we have
-                                       // virtual memory
-
-    // Check the available memory enough to load new process
-    // debug
-    if (numPages > kernel->gPhysPageBitMap->NumClear()) {
+    // Pages are loaded on demand, and evicted to swap when memory is
+    // full, so we only have to check that the program could fit in
+    // memory and swap together.
+    if (numPages > (unsigned)(NumPhysPages + kernel->swap->NumSlots())) {
         DEBUG(dbgAddr, "Not enough free space");
         numPages = 0;
         delete executable;
@@ -192,7 +811,11 @@ AddrSpace::AddrSpace(char *fileName) {
     DEBUG(dbgAddr, "Initializing address space: " << numPages << ", " << size);
     // first, set up the translation
     pageTable = new TranslationEntry[numPages];
+    copyOnWrite = new bool[numPages];
+    swapSlot = new int[numPages];
     for (i = 0; i < numPages; i++) {
+        copyOnWrite[i] = FALSE;
+        swapSlot[i] = -1;
         pageTable[i].virtualPage = i;  // for now, virtual page # = phys page #
         // pageTable[i].physicalPage = kernel->gPhysPageBitMap->FindAndSet();
         // cerr << pageTable[i].physicalPage << endl;
@@ -208,6 +831,7 @@ AddrSpace::AddrSpace(char *fileName) {
         //       PageSize);
         // DEBUG(dbgAddr, "phyPage " << pageTable[i].physicalPage);
     }
+    MapSegments(&noffH);
 
     // if (noffH.code.size > 0) {
     //     for (i = 0; i < numPages; i++)
@@ -308,6 +932,7 @@ void AddrSpace::SaveState() {}
 void AddrSpace::RestoreState() {
     kernel->machine->pageTable = pageTable;
     kernel->machine->pageTableSize = numPages;
+    kernel->machine->InvalidateTranslations();
 }
 
 //----------------------------------------------------------------------
@@ -15,9 +15,53 @@
 
 #include "copyright.h"
 #include "filesys.h"
+#include "noff.h"
 
 #define UserStackSize 1024  // increase this as necessary!
 
+// On a page fault, neighbouring pages that will probably be wanted
+// soon are loaded at the same time, as long as there are free frames
+// for them.  The window starts at the -fa setting (FaultAroundPages
+// by default), and doubles, up to MaxFaultAround, while a process
+// faults its way through memory in order.
+const int FaultAroundPages = 4;
+const int MaxFaultAround = 16;
+
+// What each page of a program's address space holds, worked out from
+// the NOFF header when the program is loaded, so that a page fault
+// knows exactly what to read from the file.  A page may overlap
+// several segments (the end of the code and the start of the data,
+// say); each overlap is a piece to read.  Wherever there is no piece,
+// the page is zero.
+enum PageKind {
+    CodePage,  // nothing but code; can be shared with other processes
+    DataPage,  // some of it (code, read-only or initialized data)
+               // comes from the file
+    BssPage,   // uninitialized data: zero, no file I/O
+    StackPage  // the user stack: zero, no file I/O
+};
+
+const int MaxPagePieces = 3;  // one for each segment in the file
+
+class PageSource {
+   public:
+    PageKind kind;
+    int numPieces;                     // how many parts of the file
+    int pieceOffset[MaxPagePieces];    // where each goes in the page,
+    int pieceFileAddr[MaxPagePieces];  // where it is in the file,
+    int pieceSize[MaxPagePieces];      // and how big it is
+};
+
+// When memory is full, a page has to be thrown out (to swap) to make
+// room; these are the ways of choosing which.  See AddrSpace::Victim.
+enum ReplacePolicy {
+    FifoReplace,    // the page that has been in memory longest
+    ClockReplace,   // second chance, sweeping the frames in turn
+    LruReplace,     // least recently used, by aging the use bits
+    WsClockReplace  // clock, preferring clean pages outside the
+                    // working set
+};
+
 class AddrSpace {
    public:
     AddrSpace();  // Create an address space.
@@ -41,11 +85,66 @@ class AddrSpace {
     int getNumPages() { return numPages; }
     TranslationEntry *getPageTable() { return pageTable; }
 
+    bool MapTextPage(int vpn);  // Map a page of the program's code,
+                                // shared with other processes running
+                                // the same program.  FALSE if the
+                                // page isn't entirely code.
+
+    bool SwapIn(int vpn);  // Bring a page back in from swap.  FALSE
+                           // if it has never been swapped out.
+
+    bool FaultIn(int vpn);  // Load a page from the program (or zero
+                            // it), along with the pages after it.
+                            // FALSE if memory is full.
+
+    bool CopyOnWrite(int vpn);  // Give this address space its own
+                                // copy of a shared page, on the first
+                                // write to it.  FALSE if the page
+                                // isn't copy-on-write.
+
+    // Physical page frames may be shared by several address spaces;
+    // kernel->frameTable keeps count of the page tables each is mapped
+    // by, and it is freed when the last one lets go.  A frame that belongs to just
+    // one address space can be evicted, when memory is full, to make
+    // room for another page.
+    static int AllocFrame(AddrSpace *owner = NULL, int vpn = 0);
+    // a new frame, for page "vpn" of "owner"
+    // (NULL if it is to be shared); -1 if
+    // none is free and none can be evicted
+    static void ShareFrame(int frame);    // one more user of "frame"
+    static void ReleaseFrame(int frame);  // one less user of "frame"
+
+    static void SetReplacePolicy(ReplacePolicy policy) {
+        replacePolicy = policy;
+    }
+    static void SetFaultAround(int pages) { faultAround = pages; }
+
    private:
     TranslationEntry *pageTable;  // Assume linear page table translation
                                   // for now!
     unsigned int numPages;        // Number of pages in the virtual
                                   // address space
+    bool *copyOnWrite;            // which pages are shared with a
+                                  // clone until one of them writes
+    int textFile;                 // the program, for sharing its code
+                                  // pages; -1 if there is none
+    int *swapSlot;                // where each page is kept in swap,
+                                  // -1 if it has never been swapped out
+    int faultWindow;              // pages to load on the next fault
+    int nextFault;                // page after the last ones loaded; a
+                                  // fault there means sequential access
+
+    PageSource *pageMap;          // where each page's contents are
+
+    void MapSegments(NoffHeader *noffH);  // work out pageMap
+    bool IsSharedText(int vpn);  // is the page entirely code?
+    bool NeedsLoading(int vpn);  // is it yet to be loaded from the file?
+
+    static int faultAround;              // initial fault-around window
+
+    static ReplacePolicy replacePolicy;  // how to choose a page to evict
+    static int Victim();                 // choose a frame to evict
+    static bool Evict(int frame);        // throw a frame's page out
 
     void InitRegisters();  // Initialize user-level CPU registers,
                            // before jumping to user code
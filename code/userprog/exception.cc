@@ -26,6 +26,7 @@
 #include "syscall.h"
 #include "ksyscall.h"
 #include "addrspace.h"
+#include "frametable.h"
 #include <iostream>
 #include <fstream>
 //----------------------------------------------------------------------
@@ -65,9 +66,12 @@ char* stringUser2System(int addr, int convert_length = -1) {
     bool stop = false;
     char* str;
 
+    // A read that faults (on a page out on swap, say) has brought the
+    // page in once ReadMem returns, so try it again.
     do {
         int oneChar;
-        kernel->machine->ReadMem(addr + length, 1, &oneChar);
+        if (!kernel->machine->ReadMem(addr + length, 1, &oneChar))
+            kernel->machine->ReadMem(addr + length, 1, &oneChar);
         length++;
         // if convert_length == -1, we use '\0' to terminate the process
         // otherwise, we use convert_length to terminate the process
@@ -78,8 +82,9 @@ char* stringUser2System(int addr, int convert_length = -1) {
     str = new char[length];
     for (int i = 0; i < length; i++) {
         int oneChar;
-        kernel->machine->ReadMem(addr + i, 1,
-                                 &oneChar);  // copy characters to kernel space
+        // copy characters to kernel space
+        if (!kernel->machine->ReadMem(addr + i, 1, &oneChar))
+            kernel->machine->ReadMem(addr + i, 1, &oneChar);
         str[i] = (unsigned char)oneChar;
     }
     return str;
@@ -96,11 +101,15 @@ char* stringUser2System(int addr, int convert_length = -1) {
  */
 void StringSys2User(char* str, int addr, int convert_length = -1) {
     int length = (convert_length == -1 ? strlen(str) : convert_length);
+    // A write that faults (on a copy-on-write page, say) has been
+    // handled once WriteMem returns, so try it again.
     for (int i = 0; i < length; i++) {
-        kernel->machine->WriteMem(addr + i, 1,
-                                  str[i]);  // copy characters to user space
+        // copy characters to user space
+        if (!kernel->machine->WriteMem(addr + i, 1, str[i]))
+            kernel->machine->WriteMem(addr + i, 1, str[i]);
     }
-    kernel->machine->WriteMem(addr + length, 1, '\0');
+    if (!kernel->machine->WriteMem(addr + length, 1, '\0'))
+        kernel->machine->WriteMem(addr + length, 1, '\0');
 }
 
 /**
@@ -415,11 +424,13 @@ void handle_SC_GetPid() {
 
 void handle_SC_ThreadSleep() {
     int ticks = kernel->machine->ReadRegister(4);
-    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
-    Thread* oldThread = kernel->currentThread;
-    kernel->scheduler->Sleep(oldThread, ticks);
-    kernel->scheduler->Run(kernel->scheduler->FindNextToRun(), false);
-    (void)kernel->interrupt->SetLevel(oldLevel);
+    kernel->alarm->WaitUntil(ticks);
+    return move_program_counter();
+}
+
+void handle_SC_SetShare() {
+    int tickets = kernel->machine->ReadRegister(4);
+    kernel->machine->WriteRegister(2, SysSetShare(tickets));
     return move_program_counter();
 }
 
@@ -443,54 +454,41 @@ void handle_SC_ThreadFork() {
 
 void handle_PageFault(int badVAdrr) {
     kernel->addrLock->P();
+    kernel->stats->numPageFaults++;
     int vpn = (unsigned)badVAdrr / PageSize;
     int offset = (unsigned)badVAdrr % PageSize;
-    if (kernel->machine->tlb == NULL) {
-        kernel->machine->pageTable[vpn].virtualPage =
-            vpn;  // for now, virtual page # = phys page #
-        kernel->machine->pageTable[vpn].physicalPage =
-            kernel->gPhysPageBitMap->FindAndSet();
-        // cerr << kernel->machine->pageTable[vpn].physicalPage << endl;
-        kernel->machine->pageTable[vpn].valid = TRUE;
-        kernel->machine->pageTable[vpn].use = FALSE;
-        kernel->machine->pageTable[vpn].dirty = FALSE;
-        kernel->machine->pageTable[vpn].readOnly =
-            FALSE;  // if the code segment was entirely on
-        // a separate page, we could set its
-        // pages to be read-only
-        // xóa các trang này trên memory
-        bzero(&(kernel->machine
-                    ->mainMemory[kernel->machine->pageTable[vpn].physicalPage *
-                                 PageSize]),
-              PageSize);
-        DEBUG(dbgAddr,
-              "phyPage " << kernel->machine->pageTable[vpn].physicalPage);
-
-        if (kernel->currentThread->noffH.code.size > 0) {
-            // for (vpn = 0; vpn < numPages; vpn++)
-            kernel->currentThread->executable->ReadAt(
-                &(kernel->machine->mainMemory[kernel->currentThread->noffH.code
-                                                  .virtualAddr]) +
-                    (kernel->machine->pageTable[vpn].physicalPage * PageSize),
-                PageSize,
-                kernel->currentThread->noffH.code.inFileAddr +
-                    (vpn * PageSize));
-        }
-
-        if (kernel->currentThread->noffH.initData.size > 0) {
-            // for (vpn = 0; vpn < numPages; vpn++)
-            kernel->currentThread->executable->ReadAt(
-                &(kernel->machine->mainMemory[kernel->currentThread->noffH
-                                                  .initData.virtualAddr]) +
-                    (kernel->machine->pageTable[vpn].physicalPage * PageSize),
-                PageSize,
-                kernel->currentThread->noffH.initData.inFileAddr +
-                    (vpn * PageSize));
-        }
+    AddrSpace* space = kernel->currentThread->space;
+    if (kernel->machine->tlb == NULL && space->MapTextPage(vpn)) {
+        // a code page, shared with other copies of the program
+    } else if (kernel->machine->tlb == NULL && space->SwapIn(vpn)) {
+        // a page that was evicted, back from swap
+    } else if (kernel->machine->tlb == NULL && !space->FaultIn(vpn)) {
+        // a first touch, loaded from the program along with the pages
+        // after it -- unless there's no room
+        cerr << "Out of memory: no page can be evicted\n";
+        kernel->frameTable->Print();
+        SysHalt();
+        ASSERTNOTREACHED();
     }
     kernel->addrLock->V();
 }
 
+// A write to a read-only page: if the page is shared copy-on-write
+// with a forked process, make a copy and retry the write.
+void handle_ReadOnly(int badVAdrr) {
+    int vpn = (unsigned)badVAdrr / PageSize;
+
+    kernel->addrLock->P();
+    bool copied = kernel->currentThread->space->CopyOnWrite(vpn);
+    kernel->addrLock->V();
+
+    if (!copied) {
+        cerr << "Error " << ReadOnlyException << " occurs\n";
+        SysHalt();
+        ASSERTNOTREACHED();
+    }
+}
+
 void handle_div_by_zero() {
     cout << "Error : Divide by Zero, core dumped\n";
 
@@ -535,7 +533,11 @@ void ExceptionHandler(ExceptionType which) {
                 SysHalt();
                 ASSERTNOTREACHED();
             }
-        case ReadOnlyException:
+        case ReadOnlyException: {
+            int badVAdrr = kernel->machine->ReadRegister(39);
+            DEBUG(dbgSys, "ReadOnlyException: " << badVAdrr << "\n");
+            return handle_ReadOnly(badVAdrr);
+        }
         case BusErrorException:
         case AddressErrorException:
         case OverflowException:
@@ -596,6 +598,8 @@ void ExceptionHandler(ExceptionType which) {
                     return handle_SC_ThreadSleep();
                 case SC_MyThreadFork:
                     return handle_SC_ThreadFork();
+                case SC_SetShare:
+                    return handle_SC_SetShare();
                 /**
                  * Handle all not implemented syscalls
                  * If you want to write a new handler for syscall:
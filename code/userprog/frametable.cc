@@ -0,0 +1,202 @@
+// frametable.cc
+//	Routines to keep track of what is in each frame of physical
+//	memory.  See frametable.h.
+//
+//	The frame table only keeps the records; the address spaces
+//	decide what to put where, and what to evict.  Callers hold
+//	kernel->addrLock.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "frametable.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// FrameTable::FrameTable
+// 	Initialize the records for "numFrames" frames of memory, all of
+//	them free.
+//----------------------------------------------------------------------
+
+FrameTable::FrameTable(int numFrames) {
+    ASSERT(numFrames > 0);
+    this->numFrames = numFrames;
+    entries = new FrameEntry[numFrames];
+    for (int i = 0; i < numFrames; i++) {
+        entries[i].owner = NULL;
+        entries[i].vpn = 0;
+        entries[i].refCount = 0;
+        entries[i].pinCount = 0;
+        entries[i].loadTime = 0;
+        entries[i].age = 0;
+        entries[i].lastUse = 0;
+    }
+    hand = 0;
+    numLoads = 0;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::~FrameTable
+// 	De-allocate the frame records.
+//----------------------------------------------------------------------
+
+FrameTable::~FrameTable() { delete[] entries; }
+
+//----------------------------------------------------------------------
+// FrameTable::Assign
+// 	Record that "frame" has just been allocated, with one user:
+//	page "vpn" of "owner", or a page that may be shared if "owner"
+//	is NULL.  Its history starts afresh.
+//----------------------------------------------------------------------
+
+void FrameTable::Assign(int frame, AddrSpace *owner, int vpn) {
+    FrameEntry *entry = &entries[frame];
+
+    ASSERT(frame >= 0 && frame < numFrames);
+    ASSERT(entry->refCount == 0 && entry->pinCount == 0);
+    entry->owner = owner;
+    entry->vpn = vpn;
+    entry->refCount = 1;
+    entry->loadTime = numLoads++;
+    entry->age = 0;
+    entry->lastUse = kernel->stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Share
+// 	Record that another page table maps "frame".  It no longer has
+//	a single owner, so it can't be evicted.
+//----------------------------------------------------------------------
+
+void FrameTable::Share(int frame) {
+    ASSERT(entries[frame].refCount > 0);
+    entries[frame].refCount++;
+    entries[frame].owner = NULL;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Release
+// 	Record that one less page table maps "frame".  Returns TRUE if
+//	that was the last, so the frame can be freed.
+//----------------------------------------------------------------------
+
+bool FrameTable::Release(int frame) {
+    FrameEntry *entry = &entries[frame];
+
+    ASSERT(entry->refCount > 0);
+    if (--entry->refCount > 0) {
+        return FALSE;
+    }
+    ASSERT(entry->pinCount == 0);
+    entry->owner = NULL;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Adopt
+// 	Record that "owner", the one page table still mapping "frame"
+//	(as its page "vpn"), has it to itself again, so it can be evicted
+//	once more.
+//----------------------------------------------------------------------
+
+void FrameTable::Adopt(int frame, AddrSpace *owner, int vpn) {
+    ASSERT(entries[frame].refCount == 1);
+    entries[frame].owner = owner;
+    entries[frame].vpn = vpn;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Disown
+// 	Record that the page in "frame" is being thrown out of memory:
+//	the owner's page table no longer maps it, and it mustn't be
+//	chosen for eviction again.  The frame stays allocated, in
+//	kernel->gPhysPageBitMap, to be reused for the page that wanted
+//	it once its contents are written out.
+//----------------------------------------------------------------------
+
+void FrameTable::Disown(int frame) {
+    ASSERT(entries[frame].owner != NULL && entries[frame].refCount == 1);
+    entries[frame].owner = NULL;
+    entries[frame].refCount = 0;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Pin
+// FrameTable::Unpin
+// 	Keep "frame" from being evicted while a transfer to or from it
+//	is in progress, and let it go again afterwards.  Pins nest.
+//----------------------------------------------------------------------
+
+void FrameTable::Pin(int frame) {
+    ASSERT(frame >= 0 && frame < numFrames);
+    entries[frame].pinCount++;
+}
+
+void FrameTable::Unpin(int frame) {
+    ASSERT(entries[frame].pinCount > 0);
+    entries[frame].pinCount--;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::IsEvictable
+// 	Return TRUE if the page in "frame" can be thrown out of memory:
+//	it has a single owner, and no transfer is in progress on it.
+//----------------------------------------------------------------------
+
+bool FrameTable::IsEvictable(int frame) {
+    return entries[frame].owner != NULL && entries[frame].pinCount == 0;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::NextHand
+// 	Return the frame the clock hand is pointing at, and move the
+//	hand on to the next, going round memory in a circle.
+//----------------------------------------------------------------------
+
+int FrameTable::NextHand() {
+    int frame = hand;
+
+    hand = (hand + 1) % numFrames;
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Print
+// 	Print what is in each frame in use, and a summary of how memory
+//	is being used, for debugging memory pressure.
+//----------------------------------------------------------------------
+
+void FrameTable::Print() {
+    int numFree = 0, numShared = 0, numPinned = 0;
+
+    cout << "Frame table:\n";
+    for (int i = 0; i < numFrames; i++) {
+        FrameEntry *entry = &entries[i];
+
+        if (entry->refCount == 0) {
+            numFree++;
+            continue;
+        }
+        if (entry->owner == NULL) {
+            numShared++;
+        }
+        if (entry->pinCount > 0) {
+            numPinned++;
+        }
+        cout << "  " << i << ": ";
+        if (entry->owner != NULL) {
+            cout << "space " << (void *)entry->owner << ", page "
+                 << entry->vpn;
+        } else {
+            cout << "shared";
+        }
+        cout << ", refs " << entry->refCount << ", pins " << entry->pinCount
+             << ", loaded " << entry->loadTime << ", age " << hex
+             << entry->age << dec << ", last use " << entry->lastUse
+             << "\n";
+    }
+    cout << "Frames: " << numFrames << ", free " << numFree << ", shared "
+         << numShared << ", pinned " << numPinned << "\n";
+}
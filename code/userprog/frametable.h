@@ -0,0 +1,79 @@
+// frametable.h
+//	Data structures for the core map: what is in each frame of
+//	physical memory, and who is using it.
+//
+//	kernel->gPhysPageBitMap says which frames are in use; the frame
+//	table says, for each one, which page of which address space it
+//	holds (so a page can be found from its frame, to evict it), how
+//	many page tables map it (for copy-on-write and shared code), and
+//	how recently it has been used (for choosing a page to evict).
+//
+//	A frame with a single user has an owner; a shared frame has
+//	none, and stays in memory until everyone has finished with it,
+//	since we can't find all the page tables it is in.  A frame can
+//	also be pinned while it is in the middle of I/O, so that it isn't
+//	taken away underneath the transfer.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FRAMETABLE_H
+#define FRAMETABLE_H
+
+#include "copyright.h"
+
+class AddrSpace;
+
+// The record kept for each frame.  Like a page table entry, it is
+// just a bundle of fields; FrameTable keeps them consistent.
+
+class FrameEntry {
+   public:
+    AddrSpace *owner;  // the only address space using the frame;
+                       // NULL if it is shared, or free
+    int vpn;           // which of the owner's pages it holds
+    int refCount;      // page tables mapping the frame; 0 if free
+    int pinCount;      // I/O transfers in progress on it
+    int loadTime;      // when it was filled (FIFO)
+    unsigned int age;  // history of its use bit (LRU)
+    int lastUse;       // tick it was last seen in use (WSClock)
+};
+
+class FrameTable {
+   public:
+    FrameTable(int numFrames);  // Initially, every frame is free
+    ~FrameTable();
+
+    void Assign(int frame, AddrSpace *owner, int vpn);
+    // "frame" has just been allocated, to
+    // hold page "vpn" of "owner" (or, if
+    // "owner" is NULL, a shared page)
+    void Share(int frame);  // Another page table maps "frame"
+    bool Release(int frame);
+    // One less page table maps "frame";
+    // return TRUE if none do any more
+    void Adopt(int frame, AddrSpace *owner, int vpn);
+    // The one remaining user of a shared
+    // frame takes it over
+    void Disown(int frame);  // The page in "frame" is being evicted
+
+    void Pin(int frame);    // Keep "frame" in memory during I/O
+    void Unpin(int frame);  // The I/O has finished
+    bool IsEvictable(int frame);  // Can "frame" be taken away?
+
+    FrameEntry *Entry(int frame) { return &entries[frame]; }
+    int NumFrames() { return numFrames; }
+    int NextHand();  // Advance the clock hand, returning
+                     // the frame it was on
+
+    void Print();  // Print the frames in use, for debugging
+
+   private:
+    int numFrames;        // how many frames there are
+    FrameEntry *entries;  // one per frame
+    int hand;             // next frame for the clock policies
+    int numLoads;         // frames filled so far
+};
+
+#endif  // FRAMETABLE_H
@@ -250,4 +250,13 @@ int SysGetPid() { return kernel->currentThread->processID; }
 
 int SysVFork() { return kernel->pTab->ExecUpdate(); }
 
+int SysSetShare(int tickets) {
+    if (tickets < 1 || tickets > MaxTickets) {
+        DEBUG(dbgSys, "\nSetShare: invalid number of tickets " << tickets);
+        return -1;
+    }
+    kernel->currentThread->tickets = tickets;
+    return 0;
+}
+
 #endif /* ! __USERPROG_KSYSCALL_H__ */
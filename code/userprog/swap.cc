@@ -0,0 +1,180 @@
+// swap.cc
+//	Routines to manage the swap area.
+//
+//	Pages come in from the disk through the synchronous disk
+//	interface, so the faulting thread waits for the transfer,
+//	letting other threads run in the meantime.  Pages going out are
+//	copied, and the copy handed to the disk without waiting; the
+//	evicting thread can get on with using the frame.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "swap.h"
+#include "main.h"
+#include "machine.h"
+#include "synchdisk.h"
+#include "synch.h"
+
+//----------------------------------------------------------------------
+// SwapSpace::SwapSpace
+// 	Set aside "numSectors" sectors of the disk, starting at
+//	"firstSector", to hold pages that have been thrown out of memory.
+//	Initially, none are in use.  There may be no sectors to spare,
+//	in which case every Alloc fails.
+//----------------------------------------------------------------------
+
+SwapSpace::SwapSpace(int first, int numSectors) {
+    ASSERT(PageSize == SectorSize);  // a page fits a sector exactly
+    ASSERT(first >= 0 && first + numSectors <= NumSectors);
+
+    firstSector = first;
+    numSlots = numSectors;
+    inUse = (numSlots > 0) ? new Bitmap(numSlots) : NULL;
+    pending = new List<SwapWrite *>;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::~SwapSpace
+// 	De-allocate the swap area.
+//----------------------------------------------------------------------
+
+SwapSpace::~SwapSpace() {
+    while (!pending->IsEmpty()) {  // Nachos is halting; writes still
+        delete pending->RemoveFront();  // queued will never be done
+    }
+    delete pending;
+    delete inUse;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Alloc
+// 	Find a free slot to write a page to.  Returns -1 if swap is full.
+//----------------------------------------------------------------------
+
+int SwapSpace::Alloc() {
+    if (inUse == NULL) {  // no swap area at all
+        return -1;
+    }
+    return inUse->FindAndSet();
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Free
+// 	The page in "slot" is no longer needed.
+//----------------------------------------------------------------------
+
+void SwapSpace::Free(int slot) {
+    ASSERT(inUse->Test(slot));
+    inUse->Clear(slot);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::ReadPage
+// 	Read the page kept in "slot" into "into", waiting until it is
+//	there.  If it was written out so recently that we still have the
+//	copy, it is taken from that instead.
+//----------------------------------------------------------------------
+
+void SwapSpace::ReadPage(int slot, char *into) {
+    SwapWrite *write = Pending(slot);
+
+    ASSERT(inUse->Test(slot));
+    if (write != NULL) {
+        DEBUG(dbgAddr, "Reading page back from its write to slot " << slot);
+        bcopy(write->data, into, SectorSize);
+        return;
+    }
+    DEBUG(dbgAddr, "Reading page in from swap slot " << slot);
+    kernel->synchDisk->ReadSector(firstSector + slot, into);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::WritePage
+// 	Start writing the page at "from" out to "slot", and return
+//	without waiting for the disk.  The page is copied first, so
+//	"from" can be reused at once.
+//
+//	An earlier write to the same slot may be waiting for the disk
+//	still; it has to land first, since the disk scheduler may not
+//	take the two in order.
+//----------------------------------------------------------------------
+
+void SwapSpace::WritePage(int slot, char *from) {
+    SwapWrite *write;
+    IntStatus oldLevel;
+
+    ASSERT(inUse->Test(slot));
+    DEBUG(dbgAddr, "Writing page out to swap slot " << slot);
+    Reap(slot);
+    write = new SwapWrite(slot, from, firstSector + slot);
+    oldLevel = kernel->interrupt->SetLevel(IntOff);
+    pending->Append(write);
+    (void)kernel->interrupt->SetLevel(oldLevel);
+    kernel->synchDisk->Submit(write->request);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Pending
+// 	Return the write to "slot" we still have, done or not; NULL if
+//	there isn't one.  There is never more than one.
+//----------------------------------------------------------------------
+
+SwapWrite *SwapSpace::Pending(int slot) {
+    ListIterator<SwapWrite *> iter(pending);
+
+    for (; !iter.IsDone(); iter.Next()) {
+        if (iter.Item()->slot == slot) {
+            return iter.Item();
+        }
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Reap
+// 	If the write to "slot" hasn't landed yet, wait for it.  Then
+//	throw away the copies of all the pages the disk has written.
+//----------------------------------------------------------------------
+
+void SwapSpace::Reap(int slot) {
+    SwapWrite *write = Pending(slot);
+    IntStatus oldLevel;
+
+    if (write != NULL && !write->written) {
+        write->landed->P();
+    }
+    oldLevel = kernel->interrupt->SetLevel(IntOff);
+    for (int n = pending->NumInList(); n > 0; n--) {
+        write = pending->RemoveFront();
+        if (write->written) {
+            delete write;
+        } else {
+            pending->Append(write);
+        }
+    }
+    (void)kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SwapWrite::SwapWrite
+// 	Copy the page at "from", and make a request to write the copy to
+//	"sector", for slot "slot", that tells us when it is done.
+//----------------------------------------------------------------------
+
+SwapWrite::SwapWrite(int slot, char *from, int sector) {
+    this->slot = slot;
+    bcopy(from, data, SectorSize);
+    written = FALSE;
+    landed = new Semaphore("swap write", 0);
+    request = new DiskRequest(sector, 1, data, TRUE);
+    request->callWhenDone = this;
+    request->done = landed;
+}
+
+SwapWrite::~SwapWrite() {
+    delete request;
+    delete landed;
+}
@@ -0,0 +1,71 @@
+// swap.h
+//	Data structures for the swap area: the place on the simulated
+//	disk where pages are kept while they are out of memory.
+//
+//	A page is exactly one disk sector, so the swap area is just a
+//	range of sectors, with a bitmap of the ones in use.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SWAP_H
+#define SWAP_H
+
+#include "copyright.h"
+#include "bitmap.h"
+#include "list.h"
+#include "disk.h"
+#include "callback.h"
+
+class Semaphore;
+class DiskRequest;
+
+// A page on its way out to swap.  The page is copied, so that its
+// frame can be used again at once, without waiting for the disk; the
+// copy is kept until the disk has written it, and the page is read
+// back from the copy if it is wanted meanwhile.
+
+class SwapWrite : public CallBackObj {
+   public:
+    SwapWrite(int slot, char *from, int sector);
+    ~SwapWrite();
+
+    void CallBack() { written = TRUE; }  // Called when the disk is
+                                         // done with it
+
+    int slot;               // where the page is going
+    char data[SectorSize];  // a copy of the page
+    bool written;           // has the disk written it?
+    Semaphore *landed;      // signalled when it has
+    DiskRequest *request;   // the write
+};
+
+class SwapSpace {
+   public:
+    SwapSpace(int firstSector, int numSectors);
+    // Use "numSectors" sectors of the disk,
+    // starting at "firstSector", for swap
+    ~SwapSpace();
+
+    int Alloc();          // Find a free slot; -1 if swap is full
+    void Free(int slot);  // Give a slot back
+    int NumSlots() { return numSlots; }
+
+    void ReadPage(int slot, char *into);   // Read a page in from swap
+    void WritePage(int slot, char *from);  // Start writing a page out
+                                           // to swap
+
+   private:
+    int firstSector;               // where the swap area starts on disk
+    int numSlots;                  // how many pages it holds
+    Bitmap *inUse;                 // which slots hold a page; NULL
+                                   // if there are none
+    List<SwapWrite *> *pending;    // writes not yet cleaned up
+
+    SwapWrite *Pending(int slot);  // The write to "slot", if any
+    void Reap(int slot);           // Clean up the writes that are
+                                   // done, waiting for any to "slot"
+};
+
+#endif  // SWAP_H
@@ -52,6 +52,7 @@
 #define SC_PrintStringUC 55
 #define SC_ThreadSleep 56
 #define SC_MyThreadFork 57
+#define SC_SetShare 58
 
 #ifndef IN_ASM
 
@@ -223,6 +224,13 @@ void ThreadSleep(int ticks);
 
 int MyThreadFork(int);
 
+/* Set the calling process's share of the CPU to "tickets", between 1 and
+ * 10000 (the default is 100).  Under stride scheduling (nachos -sched
+ * stride), processes get CPU time in proportion to their tickets.
+ * Return 0 on success, -1 if "tickets" is out of range.
+ */
+int SetShare(int tickets);
+
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */